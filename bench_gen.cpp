@@ -0,0 +1,292 @@
+// Maze generator benchmark
+// runs every carving engine (engines.h, generate_maze as map.cpp calls it) on square
+// mazes from 5x5 up to 16k x 16k, over a range of seeds, and reports for each engine
+// and size:
+//   wall clock per maze: min and the 50th, 90th and 99th percentile over the seeds
+//   cells/s and ns/cell from the median
+//   allocations: operator new calls and bytes per maze (the map buffer itself is one
+//   malloc and shows up as map_bytes instead)
+//   peak RSS of the process so far
+// results are printed as JSON, one run per line, like bench_parse, so the numbers can
+// be kept and compared from build to build.
+// -chunks n walks a 4x4 chunk window n steps across the endless chunked maze (chunk.h)
+// through a chunk_cache with prefetching on and room for only 64 chunks, and checks
+// every step that the cached chunks are the ones generate makes and that the window is
+// one maze across the chunk borders. exits 1 if not.
+//
+//Linux build: g++ -O2 bench_gen.cpp -o bench_gen -pthread
+//usage:       ./bench_gen [-max side, default 4096] [-seeds n] [-keys n] [-a engine] [-o results.json]
+//             ./bench_gen -chunks steps [-o results.json]
+//             (-max 16384 for the 16k mazes, slow for the flood engine)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#include "engines.h"
+#include "chunk.h"
+
+// every operator new in the process goes through here to be counted. the whole family
+// is replaced so what comes from std::malloc always goes back to std::free
+std::atomic<size_t> newCalls(0);
+std::atomic<size_t> newBytes(0);
+
+void* counted_alloc(size_t size) noexcept
+{
+	newCalls++;
+	newBytes += size;
+	return std::malloc(size ? size : 1);
+}
+// kept out of line: once free is inlined into a caller that got its memory from new, gcc
+// takes it for a mismatched pair (-Wmismatched-new-delete) even though new is malloc here
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+void counted_free(void* p) noexcept
+{
+	std::free(p);
+}
+void* operator new(size_t size)
+{
+	void* p = counted_alloc(size);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+void* operator new[](size_t size)
+{
+	void* p = counted_alloc(size);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return counted_alloc(size);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return counted_alloc(size);
+}
+void operator delete(void* p) noexcept
+{
+	counted_free(p);
+}
+void operator delete[](void* p) noexcept
+{
+	counted_free(p);
+}
+void operator delete(void* p, size_t) noexcept
+{
+	counted_free(p);
+}
+void operator delete[](void* p, size_t) noexcept
+{
+	counted_free(p);
+}
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	counted_free(p);
+}
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	counted_free(p);
+}
+
+// peak resident set of the process so far, in KB
+long peak_rss_kb()
+{
+#ifndef _WIN32
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024; // bytes on mac
+#else
+	return usage.ru_maxrss;
+#endif
+#else
+	return 0;
+#endif
+}
+
+// p-th percentile of sorted times, nearest rank
+double percentile(const std::vector<double>& sorted, double p)
+{
+	size_t rank = (size_t)(p / 100 * sorted.size() + 0.999999);
+	return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+// walks the window, reading it cell by cell through the cache like the game would
+bool bench_chunks(FILE* json, int steps)
+{
+	const int WINDOW = 4; // chunks across
+	const int side = WINDOW * CHUNK_SIZE;
+	chunk_world world(1);
+	int mismatched = 0, disconnected = 0;
+	size_t resident = 0, cells = 0;
+	double readTime = 0;
+	std::vector<char> window((size_t)side * side);
+	std::vector<int> queue;
+	{
+		chunk_cache cache(world, 64);
+		maze_rng rng(1);
+		int x = 0, y = 0;
+		for (int s = 0; s < steps; s++)
+		{
+			// half a chunk at a time, mostly north east so old chunks fall out of the cache
+			int d = rng.below(6);
+			int dx = d < 2 ? 1 : d == 4 ? -1 : 0, dy = d == 2 || d == 3 ? 1 : d == 5 ? -1 : 0;
+			x += dx * CHUNK_SIZE / 2;
+			y += dy * CHUNK_SIZE / 2;
+			cache.prefetch(x + dx * side / 2, y + dy * side / 2, CHUNK_SIZE); // the chunks the window moves into next
+			int cx0 = chunk_cache::floor_div(x) - WINDOW / 2, cy0 = chunk_cache::floor_div(y) - WINDOW / 2;
+			auto begin = std::chrono::steady_clock::now();
+			for (int wy = 0; wy < side; wy++)
+				for (int wx = 0; wx < side; wx++)
+					window[(size_t)wy * side + wx] = cache.cell(cx0 * CHUNK_SIZE + wx, cy0 * CHUNK_SIZE + wy);
+			readTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+			cells += (size_t)side * side;
+			resident = std::max(resident, cache.residentChunks());
+
+			// every chunk as generate makes it
+			for (int c = 0; c < WINDOW * WINDOW; c++)
+			{
+				chunk fresh;
+				world.generate(cx0 + c % WINDOW, cy0 + c / WINDOW, fresh);
+				for (int row = 0; row < CHUNK_SIZE; row++)
+					if (memcmp(&window[(size_t)((c / WINDOW) * CHUNK_SIZE + row) * side + (c % WINDOW) * CHUNK_SIZE], fresh.cells + row * CHUNK_SIZE, CHUNK_SIZE) != 0)
+					{
+						mismatched++;
+						break;
+					}
+			}
+			// each chunk is one maze with a way into all four neighbours, so a block of
+			// whole chunks is one maze too: a BFS from one cell reaches every open one
+			size_t open = 0, reached = 1;
+			for (size_t i = 0; i < window.size(); i++)
+				open += window[i] != 'W';
+			queue.assign(1, 0);
+			window[0] = 'W';
+			for (size_t q = 0; q < queue.size(); q++)
+			{
+				int wx = queue[q] % side, wy = queue[q] / side;
+				for (int d = 0; d < 4; d++)
+				{
+					int nx = wx + step_x[d], ny = wy + step_y[d];
+					if (nx >= 0 && ny >= 0 && nx < side && ny < side && window[(size_t)ny * side + nx] != 'W')
+					{
+						window[(size_t)ny * side + nx] = 'W';
+						queue.push_back(ny * side + nx);
+						reached++;
+					}
+				}
+			}
+			if (reached != open)
+				disconnected++;
+		}
+		fprintf(json, "{\"benchmark\": \"chunk walk\", \"runs\": [\n  {\"steps\": %d, \"window\": %d, \"max_chunks\": %zu, "
+			"\"peak_resident\": %zu, \"chunks_made\": %zu, \"ns_per_cell_read\": %.3f, \"mismatched\": %d, \"disconnected\": %d}\n]}\n",
+			steps, side, cache.maxChunks, resident, (size_t)cache.made, readTime * 1e9 / std::max(cells, (size_t)1), mismatched, disconnected);
+	} // the cache's prefetch thread is stopped here
+	return mismatched == 0 && disconnected == 0 && resident <= 64;
+}
+
+int main(int argc, char* argv[])
+{
+	int maxSide = 4096;
+	int seeds = 0; // 0 = more seeds for small mazes
+	int keys = 0;
+	int chunkSteps = 0;
+	const char* only = NULL;
+	FILE* json = stdout;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-max") == 0 && i + 1 < argc)
+			maxSide = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-seeds") == 0 && i + 1 < argc)
+			seeds = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-keys") == 0 && i + 1 < argc)
+			keys = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc)
+			only = argv[++i];
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			json = fopen(argv[++i], "w");
+		else if (strcmp(argv[i], "-chunks") == 0 && i + 1 < argc)
+			chunkSteps = atoi(argv[++i]);
+		else
+		{
+			printf("usage: %s [-max side] [-seeds n] [-keys n] [-a engine] [-o results.json]\n", argv[0]);
+			printf("       %s -chunks steps [-o results.json]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (json == NULL)
+	{
+		printf("Can't write the results file\n");
+		return 1;
+	}
+	if (chunkSteps > 0)
+	{
+		bool ok = bench_chunks(json, chunkSteps);
+		if (json != stdout)
+		{
+			fclose(json);
+		}
+		return ok ? 0 : 1;
+	}
+	if (only != NULL && find_engine(only) == NULL)
+	{
+		printf("no engine called '%s'\n", only);
+		return 1;
+	}
+	int sides[] = { 5, 16, 64, 256, 1024, 4096, 8192, 16384 };
+	int engineCount;
+	const maze_engine* const* engines = maze_engines(engineCount);
+	fprintf(json, "{\"benchmark\": \"maze generation\", \"threads\": %d, \"keys\": %d, \"runs\": [\n", parallelThreads(), keys);
+	bool first = true;
+	for (int e = 0; e < engineCount; e++)
+	{
+		if (only != NULL && strcmp(engines[e]->name(), only) != 0)
+			continue;
+		for (int s = 0; s < (int)(sizeof(sides) / sizeof(sides[0])) && sides[s] <= maxSide; s++)
+		{
+			int side = sides[s];
+			double cells = (double)side * side;
+			int runs = seeds > 0 ? seeds : (int)std::min(200.0, std::max(cells <= (1 << 22) ? 10.0 : 3.0, 1e6 / cells));
+			std::vector<double> times;
+			size_t calls = 0, bytes = 0, mapBytes = 0;
+			for (int r = 0; r < runs; r++)
+			{
+				maze_rng rng(1 + r, 0);
+				map_buffer map;
+				size_t callsBefore = newCalls, bytesBefore = newBytes;
+				auto begin = std::chrono::steady_clock::now();
+				generate_maze(*engines[e], map, side, side, keys, rng);
+				times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+				calls += newCalls - callsBefore;
+				bytes += newBytes - bytesBefore;
+				mapBytes = map.size;
+			}
+			std::sort(times.begin(), times.end());
+			double median = percentile(times, 50);
+			fprintf(json, "%s  {\"engine\": \"%s\", \"side\": %d, \"cells\": %.0f, \"seeds\": %d, "
+				"\"min_s\": %.9f, \"p50_s\": %.9f, \"p90_s\": %.9f, \"p99_s\": %.9f, \"ns_per_cell\": %.3f, \"cells_per_s\": %.0f, "
+				"\"allocs\": %.1f, \"alloc_bytes\": %.0f, \"map_bytes\": %zu, \"peak_rss_kb\": %ld}",
+				first ? "" : ",\n", engines[e]->name(), side, cells, runs,
+				times[0], median, percentile(times, 90), percentile(times, 99), median * 1e9 / cells, cells / median,
+				(double)calls / runs, (double)bytes / runs, mapBytes, peak_rss_kb());
+			fflush(json);
+			first = false;
+		}
+	}
+	fprintf(json, "\n]}\n");
+	if (json != stdout)
+	{
+		fclose(json);
+	}
+	return 0;
+}
@@ -0,0 +1,216 @@
+// Map loader benchmark
+// writes synthetic maps from 5x5 up to 32k x 32k with different wall and door
+// densities and times every loading phase on each one:
+//   open    mapping the file
+//   grid    allocating the wall grid (the walls around the map are implicit, there
+//           is no border setup left to time)
+//   parse   the serial pass over the cells
+//   par     the whole text load on all cores
+//   bin     loading the same map from the binary format
+// results are printed as JSON, one run per line, with MB/s and cells/s so two builds
+// can be compared before a release. ns/cell should stay flat as the map grows if the
+// loader is linear. process_peak_rss_kb is the peak of the whole process so far, not
+// of that run: it only goes up, so it is the cost of the biggest map loaded up to then.
+//
+//Linux build: g++ -O2 bench_parse.cpp -o bench_parse -pthread
+//usage:       ./bench_parse [-max side, default 16384] [-reps n] [-o results.json]
+//             (-max 32768 for the 32k maps, their text file alone is 1 GB)
+
+#include <chrono>
+#include <cstdlib>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#include "parse.h"
+
+// a random map in the format parseMapFile reads. walls is the share of wall cells,
+// doors the share of cells that get a door and another one its key. pairs past the
+// letters use numbered tags so dense maps still pair up.
+bool write_bench_map(const char* fileName, int side, double walls, double doors, unsigned seed)
+{
+	srand(seed);
+	FILE* out = fopen(fileName, "wb");
+	if (out == NULL)
+	{
+		return false;
+	}
+	fprintf(out, "%d %d\n", side, side);
+	std::vector<char> row;
+	row.reserve(side * 2 + 1);
+	int pairs = 0;
+	std::vector<int> openDoors; // doors still waiting for their key
+	char tag[16];
+	for (int j = 0; j < side; j++)
+	{
+		row.clear();
+		for (int i = 0; i < side; i++)
+		{
+			double r = rand() / (RAND_MAX + 1.0);
+			if (j == side - 1 && i == 0)
+			{
+				row.push_back('S');
+			}
+			else if (j == 0 && i == side - 1)
+			{
+				row.push_back('G');
+			}
+			else if (r < doors && !openDoors.empty() && rand() % 2 == 0)
+			{
+				int n = openDoors.back();
+				openDoors.pop_back();
+				int length = n < 23 ? sprintf(tag, "%c", "abcdefhijklmnopqrtuvxyz"[n]) : sprintf(tag, "{%d}", n);
+				row.insert(row.end(), tag, tag + length);
+			}
+			else if (r < doors)
+			{
+				int n = pairs++;
+				openDoors.push_back(n);
+				int length = n < 23 ? sprintf(tag, "%c", "ABCDEFHIJKLMNOPQRTUVXYZ"[n]) : sprintf(tag, "[%d]", n);
+				row.insert(row.end(), tag, tag + length);
+			}
+			else
+			{
+				row.push_back(r < doors + walls ? 'W' : '0');
+			}
+		}
+		row.push_back('\n');
+		fwrite(row.data(), 1, row.size(), out);
+	}
+	bool ok = !ferror(out);
+	return fclose(out) == 0 && ok;
+}
+
+// peak resident set of the process so far, in KB
+long peak_rss_kb()
+{
+#ifndef _WIN32
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024; // bytes on mac
+#else
+	return usage.ru_maxrss;
+#endif
+#else
+	return 0;
+#endif
+}
+
+double seconds_since(std::chrono::steady_clock::time_point begin)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+int main(int argc, char* argv[])
+{
+	int maxSide = 16384;
+	int reps = 0; // 0 = more repetitions for small maps
+	FILE* json = stdout;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-max") == 0 && i + 1 < argc)
+			maxSide = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-reps") == 0 && i + 1 < argc)
+			reps = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			json = fopen(argv[++i], "w");
+		else
+		{
+			printf("usage: %s [-max side] [-reps n] [-o results.json]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (json == NULL)
+	{
+		printf("Can't write the results file\n");
+		return 1;
+	}
+	const char* fileName = "bench_map.txt";
+	const char* binName = "bench_map.bin";
+	int sides[] = { 5, 16, 64, 256, 1024, 4096, 8192, 16384, 32768 };
+	double wallDensities[] = { 0.1, 0.3, 0.6 };
+	double doorDensities[] = { 0, 0.0001, 0.01 };
+	fprintf(json, "{\"benchmark\": \"map loading\", \"threads\": %d, \"runs\": [\n", parallelThreads());
+	bool first = true;
+	for (int s = 0; s < (int)(sizeof(sides) / sizeof(sides[0])) && sides[s] <= maxSide; s++)
+	{
+		for (int w = 0; w < 3; w++)
+		{
+			for (int d = 0; d < 3; d++)
+			{
+				int side = sides[s];
+				if (!write_bench_map(fileName, side, wallDensities[w], doorDensities[d], 1 + s * 9 + w * 3 + d))
+				{
+					printf("Can't write file '%s'\n", fileName);
+					return 1;
+				}
+				double cells = (double)side * side;
+				int runs = reps > 0 ? reps : (int)std::min(100.0, std::max(cells <= (1 << 22) ? 3.0 : 1.0, 1e6 / cells));
+				double openSeconds = 1e30, gridSeconds = 1e30, parseSeconds = 1e30, parSeconds = 1e30, binSeconds = 1e30;
+				size_t bytes = 0;
+				int walls = 0, doorCount = 0;
+				for (int r = 0; r < runs; r++)
+				{
+					// the serial load, phase by phase, the same steps parseMapBuffer takes
+					MazeInstance maze;
+					auto begin = std::chrono::steady_clock::now();
+					MappedFile input;
+					input.open(fileName);
+					openSeconds = std::min(openSeconds, seconds_since(begin));
+					bytes = input.size();
+
+					begin = std::chrono::steady_clock::now();
+					const char* p = input.data();
+					const char* end = p + input.size();
+					readMapInt(p, end, maze.width);
+					readMapInt(p, end, maze.height);
+					maze.grid.resize(maze.width, maze.height);
+					gridSeconds = std::min(gridSeconds, seconds_since(begin));
+
+					begin = std::chrono::steady_clock::now();
+					parseMapRows(maze, p, end, maze.height - 1, [&](char c, int x, int y, int tag) { addMapCell(maze, c, x, y, tag); });
+					parseSeconds = std::min(parseSeconds, seconds_since(begin));
+					walls = (int)maze.grid.wallCount();
+					doorCount = (int)maze.player.doors.size();
+
+					MazeInstance parallelMaze;
+					begin = std::chrono::steady_clock::now();
+					parseThreads = parallelThreads();
+					size_t oldBytes = parallelParseBytes;
+					parallelParseBytes = 0; // always take the parallel path
+					parseMapBuffer(parallelMaze, input.data(), input.size());
+					parallelParseBytes = oldBytes;
+					parSeconds = std::min(parSeconds, seconds_since(begin));
+
+					if (r == 0 && !writeMapBinary(maze, binName))
+					{
+						return 1;
+					}
+					MazeInstance binaryMaze;
+					begin = std::chrono::steady_clock::now();
+					std::shared_ptr<MappedFile> binary(new MappedFile());
+					binary->open(binName);
+					loadMapBinary(binaryMaze, binary, binName);
+					binSeconds = std::min(binSeconds, seconds_since(begin));
+				}
+				double serialSeconds = openSeconds + gridSeconds + parseSeconds;
+				fprintf(json, "%s  {\"side\": %d, \"cells\": %.0f, \"bytes\": %zu, \"wall_density\": %.2f, \"door_density\": %.4f, \"walls\": %d, \"doors\": %d, \"reps\": %d, "
+					"\"open_s\": %.9f, \"grid_s\": %.9f, \"parse_s\": %.9f, \"par_s\": %.9f, \"bin_s\": %.9f, "
+					"\"ns_per_cell\": %.3f, \"cells_per_s\": %.0f, \"mb_per_s\": %.1f, \"par_mb_per_s\": %.1f, \"process_peak_rss_kb\": %ld}",
+					first ? "" : ",\n", side, cells, bytes, wallDensities[w], doorDensities[d], walls, doorCount, runs,
+					openSeconds, gridSeconds, parseSeconds, parSeconds, binSeconds,
+					serialSeconds * 1e9 / cells, cells / serialSeconds, bytes / serialSeconds / 1e6, bytes / parSeconds / 1e6, peak_rss_kb());
+				fflush(json);
+				first = false;
+			}
+		}
+	}
+	fprintf(json, "\n]}\n");
+	if (json != stdout)
+	{
+		fclose(json);
+	}
+	remove(fileName);
+	remove(binName);
+	return 0;
+}
@@ -0,0 +1,146 @@
+// Path query benchmark
+// JPS against plain A* (pathfind.h) on the same random start/goal pairs: either the
+// maps given, or mazes made on the spot with each carving engine (engines.h), 4096 x
+// 4096 by default. every pair is run through both and the path lengths have to agree.
+// the cluster graph (hpa.h) runs the same pairs too. its paths are 4-way and only near
+// shortest so their length isn't compared, only that it finds the same ones.
+// results are printed as JSON, one run per line, like bench_parse and bench_gen:
+// mean, p50 and p99 time per query and the nodes taken off the open list (the hpa line
+// also has the time to make the graph).
+//
+//Linux build: g++ -O2 bench_path.cpp -o bench_path -pthread
+//usage:       ./bench_path [-side n] [-q queries] [-a engine] [-o results.json] [map ...]
+
+#include <algorithm>
+#include <chrono>
+#include "engines.h"
+#include "pathfind.h"
+#include "hpa.h"
+
+// runs the queries on one map and prints a line for JPS, one for A* and one for the cluster graph
+bool bench_map(FILE* json, const char* name, const MazeInstance& maze, int queries, uint64_t seed, bool& first)
+{
+	// start and goal pairs on open cells
+	std::vector<std::pair<int, int> > open;
+	maze_rng rng(seed);
+	for (int tries = 0; (int)open.size() < 2 * queries && tries < 1000 * queries; tries++)
+	{
+		int x = rng.below(maze.grid.width), y = rng.below(maze.grid.height);
+		if (!maze.grid.isWall(x, y) && maze.grid.cell(x, y) != CELL_DOOR)
+			open.push_back(std::make_pair(x, y));
+	}
+	queries = (int)open.size() / 2;
+	PathFinder finder;
+	ClusterGraph graph;
+	auto begin = std::chrono::steady_clock::now();
+	graph.build(maze);
+	double buildTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	std::vector<std::pair<int, int> > path;
+	std::vector<double> times[3];
+	double expanded[3] = { 0, 0, 0 };
+	int found = 0, mismatched = 0, hpaMismatched = 0;
+	for (int q = 0; q < queries; q++)
+	{
+		int sx = open[2 * q].first, sy = open[2 * q].second, gx = open[2 * q + 1].first, gy = open[2 * q + 1].second;
+		float cost[2];
+		bool ok[3];
+		for (int m = 0; m < 3; m++)
+		{
+			auto begin = std::chrono::steady_clock::now();
+			if (m == 2)
+				ok[m] = graph.findPath(maze, sx, sy, gx, gy, path);
+			else
+				ok[m] = m == 0 ? finder.jps(maze, sx, sy, gx, gy, path) : finder.astar(maze, sx, sy, gx, gy, path);
+			times[m].push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+			if (m < 2)
+				cost[m] = finder.cost;
+			expanded[m] += m == 2 ? graph.expanded : finder.expanded;
+		}
+		found += ok[0] ? 1 : 0;
+		if (ok[0] != ok[1] || fabs(cost[0] - cost[1]) > 1e-3f * std::max(1.0f, cost[1]))
+			mismatched++;
+		if (ok[2] != ok[1])
+			hpaMismatched++;
+	}
+	const char* methods[3] = { "jps", "astar", "hpa" };
+	for (int m = 0; m < 3 && queries > 0; m++)
+	{
+		double total = 0;
+		for (size_t i = 0; i < times[m].size(); i++)
+			total += times[m][i];
+		std::sort(times[m].begin(), times[m].end());
+		fprintf(json, "%s  {\"map\": \"%s\", \"width\": %d, \"height\": %d, \"method\": \"%s\", \"queries\": %d, \"found\": %d, "
+			"\"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p99_ms\": %.4f, \"expanded\": %.1f, \"mismatched\": %d",
+			first ? "" : ",\n", name, maze.grid.width, maze.grid.height, methods[m], queries, found,
+			total * 1e3 / queries, times[m][times[m].size() / 2] * 1e3, times[m][std::min(times[m].size() - 1, times[m].size() * 99 / 100)] * 1e3,
+			expanded[m] / queries, m == 2 ? hpaMismatched : mismatched);
+		if (m == 2)
+			fprintf(json, ", \"build_ms\": %.1f, \"nodes\": %zu", buildTime * 1e3, graph.nodeCount());
+		fprintf(json, "}");
+		fflush(json);
+		first = false;
+	}
+	return mismatched == 0 && hpaMismatched == 0;
+}
+
+int main(int argc, char* argv[])
+{
+	int side = 4096;
+	int queries = 200;
+	const char* only = NULL;
+	FILE* json = stdout;
+	std::vector<const char*> maps;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-side") == 0 && i + 1 < argc)
+			side = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc)
+			queries = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc)
+			only = argv[++i];
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			json = fopen(argv[++i], "w");
+		else if (argv[i][0] == '-')
+		{
+			printf("usage: %s [-side n] [-q queries] [-a engine] [-o results.json] [map ...]\n", argv[0]);
+			return 1;
+		}
+		else
+			maps.push_back(argv[i]);
+	}
+	if (json == NULL)
+	{
+		printf("Can't write the results file\n");
+		return 1;
+	}
+	bool first = true, ok = true;
+	fprintf(json, "{\"benchmark\": \"path queries\", \"runs\": [\n");
+	for (size_t i = 0; i < maps.size(); i++)
+	{
+		MazeInstance maze;
+		std::cout.setstate(std::ios::failbit); // parseMapFile talks on cout, keep it out of the JSON
+		parseMapFile(maze, maps[i]);
+		std::cout.clear();
+		ok = bench_map(json, maps[i], maze, queries, 1, first) && ok;
+	}
+	int engineCount;
+	const maze_engine* const* engines = maze_engines(engineCount);
+	for (int e = 0; e < engineCount && maps.empty(); e++)
+	{
+		if (only != NULL && strcmp(engines[e]->name(), only) != 0)
+			continue;
+		maze_rng rng(1);
+		map_buffer map;
+		generate_maze(*engines[e], map, side, side, 0, rng);
+		MazeInstance maze;
+		parseMapBuffer(maze, map.data, map.size);
+		map.release();
+		ok = bench_map(json, engines[e]->name(), maze, queries, 2, first) && ok;
+	}
+	fprintf(json, "\n]}\n");
+	if (json != stdout)
+	{
+		fclose(json);
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,384 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "parse.h"
+// flood fill on bits instead of cells: a set of cells is one bit per cell with rows
+// padded to whole 64 bit words, just like the wall bits in grid.h, and a step of the
+// fill is shifts, ANDs and ORs on whole words. the row loops are plain word loops the
+// compiler can turn into SIMD.
+//   reachable cells: a whole run of open cells along a row fills in one go (an add
+//   carries along the run one way, a log step fill the other way), rows are swept up
+//   and down the map until nothing changes, only the words next to a change are looked
+//   at again. on open maps that is many cells per word op, in perfect mazes with one
+//   cell wide corridors it comes down to about the speed of a scalar BFS.
+//   distance layers: a real BFS, one layer of cells per step, only the rows the layer
+//   is on are touched.
+// used to check generated maps can be finished (bitFloodSolvable) without a full
+// state search, solver.h is the one that finds the actual route.
+class BitBoard {
+public:
+	int width = 0;
+	int height = 0;
+	int wordsPerRow = 0;
+	std::vector<uint64_t> bits;
+
+	void resize(int width, int height)
+	{
+		this->width = width > 0 ? width : 0;
+		this->height = height > 0 ? height : 0;
+		wordsPerRow = (this->width + 63) / 64;
+		bits.assign((size_t)wordsPerRow * this->height, 0);
+	}
+	uint64_t* row(int y)
+	{
+		return bits.data() + (size_t)y * wordsPerRow;
+	}
+	const uint64_t* row(int y) const
+	{
+		return bits.data() + (size_t)y * wordsPerRow;
+	}
+	bool get(int x, int y) const
+	{
+		return x >= 0 && y >= 0 && x < width && y < height && (row(y)[x >> 6] >> (x & 63)) & 1;
+	}
+	void set(int x, int y, bool on = true)
+	{
+		uint64_t bit = (uint64_t)1 << (x & 63);
+		if (on)
+			row(y)[x >> 6] |= bit;
+		else
+			row(y)[x >> 6] &= ~bit;
+	}
+	size_t count() const
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < bits.size(); i++)
+		{
+			total += countBits(bits[i]);
+		}
+		return total;
+	}
+	// calls fn(x, y) for every cell in rows y0..y1
+	template <class Fn>
+	void forEach(int y0, int y1, Fn fn) const
+	{
+		for (int y = y0; y <= y1; y++)
+		{
+			const uint64_t* bitsRow = row(y);
+			for (int w = 0; w < wordsPerRow; w++)
+			{
+				uint64_t word = bitsRow[w];
+				while (word)
+				{
+					fn(w * 64 + lowestBit(word), y);
+					word &= word - 1;
+				}
+			}
+		}
+	}
+};
+
+// the cells that can be walked on: not wall and not a door whose key is missing.
+// keys[i] != 0 means the key of door i is held (keys can be shorter than doors)
+void passableBoard(const MazeInstance& maze, const std::vector<char>& keys, BitBoard& pass)
+{
+	const Grid& grid = maze.grid;
+	pass.resize(grid.width, grid.height);
+	if (grid.wordsPerRow > 0)
+	{
+		uint64_t lastWord = (grid.width & 63) ? ((uint64_t)1 << (grid.width & 63)) - 1 : ~(uint64_t)0;
+		for (int y = 0; y < grid.height; y++)
+		{
+			const uint64_t* walls = grid.row(y);
+			uint64_t* open = pass.row(y);
+			for (int w = 0; w < pass.wordsPerRow; w++)
+			{
+				open[w] = ~walls[w];
+			}
+			open[pass.wordsPerRow - 1] &= lastWord;
+		}
+	}
+	else // paged map, no rows in memory
+	{
+		for (int y = 0; y < grid.height; y++)
+			for (int x = 0; x < grid.width; x++)
+				if (!grid.isWall(x, y))
+					pass.set(x, y);
+	}
+	for (size_t i = 0; i < maze.player.doors.size(); i++)
+	{
+		const Door& door = maze.player.doors[i];
+		if (door.door != 0 && (i >= keys.size() || !keys[i]) && grid.inside(door.doorx, door.doory))
+			pass.set(door.doorx, door.doory, false);
+	}
+}
+
+// spreads the reached bits of one row along the runs of passable cells, both ways.
+// towards higher x an add does it: the carry runs up a run of ones. towards lower x
+// it is a fill by 1, 2, 4 ... 32 cells. runs going over a word edge carry into the
+// next word
+inline void fillRow(uint64_t* reach, const uint64_t* pass, int words)
+{
+	uint64_t carry = 0;
+	for (int w = 0; w < words; w++)
+	{
+		uint64_t x = (reach[w] | carry) & pass[w];
+		x |= ((pass[w] + x) ^ pass[w]) & pass[w];
+		reach[w] = x;
+		carry = x >> 63;
+	}
+	carry = 0;
+	for (int w = words - 1; w >= 0; w--)
+	{
+		uint64_t open = pass[w];
+		uint64_t x = reach[w] | ((carry << 63) & open);
+		x |= open & (x >> 1);
+		open &= open >> 1;
+		x |= open & (x >> 2);
+		open &= open >> 2;
+		x |= open & (x >> 4);
+		open &= open >> 4;
+		x |= open & (x >> 8);
+		open &= open >> 8;
+		x |= open & (x >> 16);
+		open &= open >> 16;
+		x |= open & (x >> 32);
+		reach[w] = x;
+		carry = x & 1;
+	}
+}
+
+// pulls what the rows below and above reached into words first..last of row y, then
+// fills it along the row as far as the runs go. c0..c1 are the words that changed,
+// false if none did. the row was filled before, so the fill stops at the first word
+// past the new bits that doesn't change
+inline bool growRow(const BitBoard& pass, BitBoard& reach, int y, int first, int last, int& c0, int& c1)
+{
+	int words = pass.wordsPerRow;
+	uint64_t* bits = reach.row(y);
+	const uint64_t* open = pass.row(y);
+	const uint64_t* down = y > 0 ? reach.row(y - 1) : NULL;
+	const uint64_t* over = y + 1 < pass.height ? reach.row(y + 1) : NULL;
+	c0 = words;
+	c1 = -1;
+	for (int w = first; w <= last; w++)
+	{
+		uint64_t from = (down ? down[w] : 0) | (over ? over[w] : 0);
+		uint64_t x = from & open[w] & ~bits[w];
+		if (x)
+		{
+			bits[w] |= x;
+			c0 = std::min(c0, w);
+			c1 = std::max(c1, w);
+		}
+	}
+	if (c1 < 0)
+		return false;
+	uint64_t carry = 0;
+	for (int w = c0; w < words; w++) // towards higher x
+	{
+		uint64_t x = (bits[w] | carry) & open[w];
+		x |= ((open[w] + x) ^ open[w]) & open[w];
+		if (x != bits[w])
+		{
+			bits[w] = x;
+			c1 = std::max(c1, w);
+		}
+		else if (w > c1)
+			break;
+		carry = x >> 63;
+	}
+	carry = 0;
+	for (int w = c1; w >= 0; w--) // towards lower x
+	{
+		uint64_t x = bits[w] | ((carry << 63) & open[w]);
+		uint64_t run = open[w];
+		x |= run & (x >> 1);
+		run &= run >> 1;
+		x |= run & (x >> 2);
+		run &= run >> 2;
+		x |= run & (x >> 4);
+		run &= run >> 4;
+		x |= run & (x >> 8);
+		run &= run >> 8;
+		x |= run & (x >> 16);
+		run &= run >> 16;
+		x |= run & (x >> 32);
+		if (x != bits[w])
+		{
+			bits[w] = x;
+			c0 = std::min(c0, w);
+		}
+		else if (w < c0)
+			break;
+		carry = x & 1;
+	}
+	return true;
+}
+
+// grows reach (the cells reached so far) to every cell connected to it through pass.
+// every row is filled along itself once, then the map is swept up and back down until
+// a sweep changes nothing. a row is only looked at where a row next to it changed, so
+// a corridor winding through the map costs a word or two per row it enters
+void floodBoard(const BitBoard& pass, BitBoard& reach)
+{
+	int height = pass.height, words = pass.wordsPerRow;
+	if (height == 0 || words == 0)
+		return;
+	for (int y = 0; y < height; y++)
+	{
+		uint64_t* bits = reach.row(y);
+		const uint64_t* open = pass.row(y);
+		for (int w = 0; w < words; w++)
+			bits[w] &= open[w];
+		fillRow(bits, open, words);
+	}
+	// words lo..hi of a row need another look, a row next to it changed there
+	std::vector<int> lo(height, 0), hi(height, words - 1);
+	bool any = true;
+	for (int sweep = 0; any; sweep++)
+	{
+		any = false;
+		bool up = sweep % 2 == 0;
+		for (int i = 0; i < height; i++)
+		{
+			int y = up ? i : height - 1 - i;
+			if (lo[y] > hi[y])
+				continue;
+			int first = lo[y], last = hi[y];
+			lo[y] = words;
+			hi[y] = -1;
+			int c0, c1;
+			if (!growRow(pass, reach, y, first, last, c0, c1))
+				continue;
+			any = true;
+			if (y > 0)
+			{
+				lo[y - 1] = std::min(lo[y - 1], c0);
+				hi[y - 1] = std::max(hi[y - 1], c1);
+			}
+			if (y + 1 < height)
+			{
+				lo[y + 1] = std::min(lo[y + 1], c0);
+				hi[y + 1] = std::max(hi[y + 1], c1);
+			}
+		}
+	}
+}
+
+// the cells reachable from (x, y) with the keys held, see passableBoard
+void reachableFrom(const MazeInstance& maze, int x, int y, const std::vector<char>& keys, BitBoard& reach)
+{
+	BitBoard pass;
+	passableBoard(maze, keys, pass);
+	reach.resize(pass.width, pass.height);
+	if (pass.get(x, y))
+	{
+		reach.set(x, y);
+		floodBoard(pass, reach);
+	}
+}
+
+// BFS from (x, y) through pass, a layer at a time: fn(distance, layer, y0, y1) for
+// every distance, layer holds exactly the cells that far away, all of them in rows
+// y0..y1. returns how many cells were reached
+template <class Fn>
+size_t distanceLayers(const BitBoard& pass, int x, int y, Fn fn)
+{
+	if (!pass.get(x, y))
+		return 0;
+	int height = pass.height, words = pass.wordsPerRow;
+	BitBoard seen, layer, next;
+	seen.resize(pass.width, height);
+	layer.resize(pass.width, height);
+	next.resize(pass.width, height);
+	seen.set(x, y);
+	layer.set(x, y);
+	int y0 = y, y1 = y;
+	for (int distance = 0; y0 <= y1; distance++)
+	{
+		fn(distance, layer, y0, y1);
+		// one step in all four directions from every cell of the layer
+		int n0 = height, n1 = -1;
+		for (int ny = y0 > 0 ? y0 - 1 : 0; ny <= y1 + 1 && ny < height; ny++)
+		{
+			const uint64_t* here = layer.row(ny);
+			const uint64_t* down = ny > 0 ? layer.row(ny - 1) : NULL;
+			const uint64_t* over = ny + 1 < height ? layer.row(ny + 1) : NULL;
+			const uint64_t* open = pass.row(ny);
+			uint64_t* visited = seen.row(ny);
+			uint64_t* out = next.row(ny);
+			uint64_t any = 0;
+			for (int w = 0; w < words; w++)
+			{
+				uint64_t step = (here[w] << 1) | (here[w] >> 1);
+				if (w > 0)
+					step |= here[w - 1] >> 63;
+				if (w + 1 < words)
+					step |= here[w + 1] << 63;
+				if (down)
+					step |= down[w];
+				if (over)
+					step |= over[w];
+				step &= open[w] & ~visited[w];
+				visited[w] |= step;
+				out[w] = step;
+				any |= step;
+			}
+			if (any)
+			{
+				n0 = std::min(n0, ny);
+				n1 = std::max(n1, ny);
+			}
+		}
+		for (int ly = y0; ly <= y1; ly++) // clear the old layer, it becomes the next one
+			memset(layer.row(ly), 0, words * sizeof(uint64_t));
+		std::swap(layer.bits, next.bits);
+		y0 = n0;
+		y1 = n1;
+	}
+	return seen.count();
+}
+
+// distance of every cell from (x, y), -1 where it can't be reached. dist is y * width + x
+void distanceField(const BitBoard& pass, int x, int y, std::vector<int>& dist)
+{
+	dist.assign((size_t)pass.width * pass.height, -1);
+	distanceLayers(pass, x, y, [&](int distance, const BitBoard& layer, int y0, int y1) {
+		layer.forEach(y0, y1, [&](int cx, int cy) { dist[(size_t)cy * pass.width + cx] = distance; });
+	});
+}
+
+// the map can be finished: flood from the start, pick up every key the flood reached
+// and open its door, flood on from there, until the goal is reached or no new key
+// turns up. keys are kept once picked up, so the order they are found in doesn't matter
+bool bitFloodSolvable(const MazeInstance& maze)
+{
+	const std::vector<Door>& doors = maze.player.doors;
+	std::vector<char> keys(doors.size(), 0);
+	BitBoard pass, reach;
+	passableBoard(maze, keys, pass);
+	reach.resize(pass.width, pass.height);
+	if (!pass.get(maze.player.startx, maze.player.starty))
+		return false;
+	reach.set(maze.player.startx, maze.player.starty);
+	while (true)
+	{
+		floodBoard(pass, reach);
+		if (reach.get(maze.player.goalx, maze.player.goaly))
+			return true;
+		bool found = false;
+		for (size_t i = 0; i < doors.size(); i++)
+		{
+			if (!keys[i] && doors[i].key != 0 && doors[i].door != 0 && reach.get(doors[i].keyhomex, doors[i].keyhomey))
+			{
+				keys[i] = 1;
+				if (maze.grid.inside(doors[i].doorx, doors[i].doory) && !maze.grid.isWall(doors[i].doorx, doors[i].doory))
+					pass.set(doors[i].doorx, doors[i].doory);
+				found = true;
+			}
+		}
+		if (!found)
+			return false;
+	}
+}
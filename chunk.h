@@ -0,0 +1,272 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <unordered_map>
+#include "generate.h"
+// endless maze made of 64x64 chunks. any chunk can be made on its own from
+// (world seed, chunk x, chunk y), with nothing shared between chunks, so they can be
+// made in any order, thrown away and made again.
+//
+// inside a chunk maze cells sit on even local coordinates and are joined into one
+// perfect maze (recursive backtracker). column 63 and line 63 are the borders to the
+// east and north neighbours and only this chunk writes them: it opens 1 to 3 places
+// picked from a hash of the seed and its own chunk coordinates. the neighbour never
+// looks at them, its column or line 0 is maze cells on every even place so any
+// opening lands on an open cell. so every chunk is connected inside and to all four
+// neighbours, and the whole world is one maze (with a few loops across borders).
+// cells are '0', 'W', 'S' (world 0, 0) and 'G' (the last cell of the goal chunk).
+const int CHUNK_SIZE = 64;
+const int CHUNK_CELLS = CHUNK_SIZE / 2; // maze cells across a chunk
+
+class chunk
+{
+public:
+	int cx;
+	int cy;
+	char cells[CHUNK_SIZE * CHUNK_SIZE]; // y up, row y at y * CHUNK_SIZE
+
+	char at(int x, int y) const
+	{
+		return cells[y * CHUNK_SIZE + x];
+	}
+};
+
+class chunk_world
+{
+public:
+	uint64_t seed;
+	bool hasGoal = false;
+	int goalChunkX = 0;
+	int goalChunkY = 0;
+
+	chunk_world(uint64_t seed) : seed(seed) {}
+
+	// make chunk (cx, cy), always the same for the same seed
+	void generate(int cx, int cy, chunk& out) const
+	{
+		out.cx = cx;
+		out.cy = cy;
+		memset(out.cells, 'W', sizeof(out.cells));
+
+		// carve the inside: recursive backtracker over the 32x32 cells
+		maze_rng rng(hash(cx, cy, 0));
+		uint16_t stack[CHUNK_CELLS * CHUNK_CELLS];
+		int top = 0;
+		int first = rng.below(CHUNK_CELLS * CHUNK_CELLS);
+		stack[top++] = (uint16_t)first;
+		out.cells[cell_index(first)] = '0';
+		while (top > 0)
+		{
+			int c = stack[top - 1];
+			int x = c % CHUNK_CELLS, y = c / CHUNK_CELLS;
+			int next[4], n = 0;
+			for (int d = 0; d < 4; d++)
+			{
+				int nx = x + step_x[d], ny = y + step_y[d];
+				if (nx >= 0 && nx < CHUNK_CELLS && ny >= 0 && ny < CHUNK_CELLS && out.cells[cell_index(ny * CHUNK_CELLS + nx)] == 'W')
+				{
+					next[n++] = d;
+				}
+			}
+			if (n == 0)
+			{
+				top--;
+				continue;
+			}
+			int d = next[rng.below(n)];
+			int nc = (y + step_y[d]) * CHUNK_CELLS + x + step_x[d];
+			out.cells[(2 * y + step_y[d]) * CHUNK_SIZE + 2 * x + step_x[d]] = '0'; // the wall between
+			out.cells[cell_index(nc)] = '0';
+			stack[top++] = (uint16_t)nc;
+		}
+
+		// open our east and north borders, the west and south ones belong to the neighbours
+		bool open[CHUNK_CELLS];
+		border(cx, cy, 1, open);
+		for (int i = 0; i < CHUNK_CELLS; i++)
+			if (open[i])
+				out.cells[2 * i * CHUNK_SIZE + CHUNK_SIZE - 1] = '0';
+		border(cx, cy, 2, open);
+		for (int i = 0; i < CHUNK_CELLS; i++)
+			if (open[i])
+				out.cells[(CHUNK_SIZE - 1) * CHUNK_SIZE + 2 * i] = '0';
+
+		if (cx == 0 && cy == 0)
+			out.cells[0] = 'S';
+		if (hasGoal && cx == goalChunkX && cy == goalChunkY)
+			out.cells[(CHUNK_SIZE - 2) * CHUNK_SIZE + CHUNK_SIZE - 2] = 'G';
+	}
+private:
+	static int cell_index(int c)
+	{
+		return 2 * (c / CHUNK_CELLS) * CHUNK_SIZE + 2 * (c % CHUNK_CELLS);
+	}
+	uint64_t hash(int cx, int cy, int salt) const
+	{
+		uint64_t h = seed ^ ((uint64_t)(uint32_t)cx * 0x9E3779B97F4A7C15ull) ^ ((uint64_t)(uint32_t)cy * 0xC2B2AE3D27D4EB4Full) ^ ((uint64_t)salt << 56);
+		h = (h ^ (h >> 33)) * 0xFF51AFD7ED558CCDull;
+		h = (h ^ (h >> 33)) * 0xC4CEB9FE1A85EC53ull;
+		return h ^ (h >> 33);
+	}
+	// which cells along the border chunk (cx, cy) owns on side 1 (east) or 2 (north) get
+	// a way through
+	void border(int cx, int cy, int side, bool open[CHUNK_CELLS]) const
+	{
+		maze_rng rng(hash(cx, cy, side));
+		for (int i = 0; i < CHUNK_CELLS; i++)
+			open[i] = false;
+		int count = 1 + rng.below(3);
+		for (int i = 0; i < count; i++)
+			open[rng.below(CHUNK_CELLS)] = true;
+	}
+};
+
+// the chunks around the player. get() makes a chunk when it is not cached, prefetch()
+// has a background thread make the ones around a spot before they are needed.
+// least recently used chunks are dropped past maxChunks (4 KB each).
+class chunk_cache
+{
+public:
+	size_t maxChunks;
+	std::atomic<size_t> made; // chunks generated so far, by get() and the prefetch thread
+
+	chunk_cache(const chunk_world& world, size_t maxChunks = 256) : maxChunks(maxChunks), made(0), world(world)
+	{
+		worker = std::thread([this]() { prefetch_loop(); });
+	}
+	~chunk_cache()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+		wake.notify_one();
+		worker.join();
+	}
+	std::shared_ptr<const chunk> get(int cx, int cy)
+	{
+		std::shared_ptr<const chunk> found = lookup(cx, cy);
+		if (found)
+		{
+			return found;
+		}
+		std::shared_ptr<chunk> fresh(new chunk());
+		world.generate(cx, cy, *fresh);
+		made++;
+		insert(fresh);
+		return fresh;
+	}
+	// world cell, x and y can be anything
+	char cell(int x, int y)
+	{
+		int cx = floor_div(x), cy = floor_div(y);
+		return get(cx, cy)->at(x - cx * CHUNK_SIZE, y - cy * CHUNK_SIZE);
+	}
+	// make the chunks within radius cells of (x, y) in the background, nearest first.
+	// a newer call replaces an older one that is not done yet
+	void prefetch(int x, int y, int radius)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			wantX = x;
+			wantY = y;
+			wantRadius = radius;
+			wanted = true;
+		}
+		wake.notify_one();
+	}
+	size_t residentChunks()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return lru.size();
+	}
+	static int floor_div(int v)
+	{
+		return v >= 0 ? v / CHUNK_SIZE : -((-v + CHUNK_SIZE - 1) / CHUNK_SIZE);
+	}
+private:
+	chunk_world world;
+	std::list<std::shared_ptr<const chunk> > lru; // most recently used first
+	std::unordered_map<uint64_t, std::list<std::shared_ptr<const chunk> >::iterator> index;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::thread worker;
+	bool quit = false;
+	bool wanted = false;
+	int wantX = 0, wantY = 0, wantRadius = 0;
+
+	static uint64_t key(int cx, int cy)
+	{
+		return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+	}
+	std::shared_ptr<const chunk> lookup(int cx, int cy)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = index.find(key(cx, cy));
+		if (it == index.end())
+		{
+			return std::shared_ptr<const chunk>();
+		}
+		lru.splice(lru.begin(), lru, it->second);
+		return lru.front();
+	}
+	void insert(std::shared_ptr<const chunk> c)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		uint64_t k = key(c->cx, c->cy);
+		if (index.count(k)) // made twice at once, keep the first
+		{
+			return;
+		}
+		lru.push_front(c);
+		index[k] = lru.begin();
+		while (lru.size() > maxChunks && lru.size() > 1)
+		{
+			index.erase(key(lru.back()->cx, lru.back()->cy));
+			lru.pop_back();
+		}
+	}
+	void prefetch_loop()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!quit)
+		{
+			wake.wait(lock, [this]() { return quit || wanted; });
+			if (quit)
+			{
+				break;
+			}
+			wanted = false;
+			int x = wantX, y = wantY, radius = wantRadius;
+			lock.unlock();
+			// rings of chunks around the spot, nearest first, until a newer request comes in
+			int cx = floor_div(x), cy = floor_div(y), rings = radius / CHUNK_SIZE + 1;
+			for (int r = 0; r <= rings; r++)
+			{
+				for (int dy = -r; dy <= r; dy++)
+				{
+					for (int dx = -r; dx <= r; dx++)
+					{
+						if ((dx == -r || dx == r || dy == -r || dy == r) && !lookup(cx + dx, cy + dy))
+						{
+							get(cx + dx, cy + dy);
+						}
+					}
+				}
+				std::lock_guard<std::mutex> check(mutex);
+				if (wanted || quit)
+				{
+					break;
+				}
+			}
+			lock.lock();
+		}
+	}
+	chunk_cache(const chunk_cache&);
+	chunk_cache& operator=(const chunk_cache&);
+};
@@ -0,0 +1,170 @@
+#pragma once
+#include <cstdio>
+#include <vector>
+#include "generate.h"
+#include "unionfind.h"
+// Eller's algorithm: makes a perfect maze one row at a time, keeping only the current
+// row (O(width) memory), so the maze can be as long as the disk or the player allows.
+// rows come out top first in map file form. maze cells sit on even columns and even
+// lines, the odd ones are the walls between them, opened where two cells are joined.
+class eller_stream
+{
+public:
+	eller_stream(int width, uint64_t seed, uint64_t stream = 0) : rng(seed, stream)
+	{
+		this->width = width;
+		cells = (width + 1) / 2;
+		set.resize(cells);
+		down.resize(cells);
+		right.resize(cells);
+		for (int i = 0; i < cells; i++)
+		{
+			set[i] = i;
+		}
+		joined.reset(2 * cells);
+		remap.assign(2 * cells, -1);
+		count.assign(2 * cells, 0);
+		pick.resize(2 * cells);
+		goesDown.assign(2 * cells, 0);
+	}
+	// the next line of the map, width chars. last makes this cell line the bottom of
+	// the maze: everything left apart is joined on it and nothing goes further down.
+	void next_row(char* row, bool last = false)
+	{
+		if (finished) // lines past the bottom cell line are solid
+		{
+			memset(row, 'W', width);
+			return;
+		}
+		if (cellLine)
+		{
+			join_across(last);
+			for (int x = 0; x < width; x++)
+			{
+				row[x] = (x % 2 == 0 || right[x / 2]) ? '0' : 'W';
+			}
+			finished = last;
+			if (!last)
+			{
+				choose_down();
+			}
+		}
+		else
+		{
+			for (int x = 0; x < width; x++)
+			{
+				row[x] = (x % 2 == 0 && down[x / 2]) ? '0' : 'W';
+			}
+		}
+		cellLine = !cellLine;
+	}
+private:
+	int width;
+	int cells;
+	bool cellLine = true;
+	bool finished = false;
+	maze_rng rng;
+	std::vector<int> set;    // set label of each cell in the row, < 2 * cells
+	std::vector<char> down;  // cell is open to the one below
+	std::vector<char> right; // cell is open to the one on its right
+	union_find joined;
+	std::vector<int> remap;
+	std::vector<int> count;
+	std::vector<int> pick;
+	std::vector<char> goesDown;
+
+	// open walls between neighbours in different sets, some at random, all on the last row
+	void join_across(bool last)
+	{
+		joined.reset(2 * cells);
+		for (int i = 0; i < cells; i++)
+		{
+			right[i] = false;
+		}
+		for (int i = 0; i + 1 < cells; i++)
+		{
+			if ((last || rng.rand01() < 0.5f) && joined.unite(set[i], set[i + 1]))
+			{
+				right[i] = true;
+			}
+		}
+		for (int i = 0; i < cells; i++)
+		{
+			set[i] = (int)joined.find(set[i]);
+		}
+	}
+	// every set carries on down through at least one cell (picked evenly among its
+	// cells if none went down by chance), the other cells of the next row start new sets
+	void choose_down()
+	{
+		for (int i = 0; i < cells; i++)
+		{
+			int s = set[i];
+			down[i] = rng.rand01() < 0.5f;
+			goesDown[s] |= down[i];
+			count[s]++;
+			if (rng.below(count[s]) == 0)
+			{
+				pick[s] = i;
+			}
+		}
+		for (int i = 0; i < cells; i++)
+		{
+			int s = set[i];
+			if (!goesDown[s])
+			{
+				down[pick[s]] = true;
+				goesDown[s] = true;
+			}
+		}
+		// relabel: sets that go on get 0, 1, 2 ..., new cells get cells + i
+		int next = 0;
+		for (int i = 0; i < cells; i++)
+		{
+			int s = set[i];
+			count[s] = 0;
+			goesDown[s] = 0;
+			if (down[i])
+			{
+				if (remap[s] < 0)
+				{
+					remap[s] = next++;
+				}
+			}
+		}
+		for (int i = 0; i < cells; i++)
+		{
+			int s = set[i];
+			set[i] = down[i] ? remap[s] : cells + i;
+		}
+		std::fill(remap.begin(), remap.end(), -1);
+	}
+};
+
+// stream a whole width x height Eller maze to out in the map file format, start in the
+// top left cell and goal in the bottom right one. only one row is ever in memory.
+bool generate_eller(FILE* out, int width, int height, uint64_t seed)
+{
+	eller_stream maze(width, seed);
+	std::vector<char> row(width + 1);
+	row[width] = '\n';
+	int lastCellLine = (height - 1) & ~1;
+	fprintf(out, "%d %d\n", width, height);
+	for (int y = 0; y < height; y++)
+	{
+		maze.next_row(row.data(), y == lastCellLine);
+		if (y == 0)
+		{
+			row[0] = 'S';
+		}
+		if (y == lastCellLine)
+		{
+			row[(width - 1) & ~1] = 'G';
+		}
+		if (fwrite(row.data(), 1, row.size(), out) != row.size())
+		{
+			return false;
+		}
+	}
+	return true;
+}
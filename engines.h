@@ -0,0 +1,417 @@
+#pragma once
+#include <cstring>
+#include <vector>
+#include "generate.h"
+#include "unionfind.h"
+#include "parallel.h"
+// carving algorithms behind one interface, picked by name at run time (map -a).
+// every engine carves into the same map_buffer and marks 'S' and 'G', keys are put in
+// afterwards by spawn_keys whatever the engine.
+//
+// flood is the original probabilistic flood (carve_flood). the others make perfect
+// mazes on a lattice: maze cells on even x and y, the odd cells between them are the
+// walls, opened where two cells are joined. start is the bottom left cell, goal the
+// top right one.
+class maze_engine
+{
+public:
+	virtual ~maze_engine() {}
+	virtual const char* name() const = 0;
+	// map is fresh from map.create (all '0')
+	virtual bool carve(map_buffer& map, int width, int height, maze_rng& rng, int& startx, int& starty, int& goalx, int& goaly) const = 0;
+};
+
+class flood_engine : public maze_engine
+{
+public:
+	const char* name() const { return "flood"; }
+	bool carve(map_buffer& map, int width, int height, maze_rng& rng, int& startx, int& starty, int& goalx, int& goaly) const
+	{
+		return carve_flood(map, width, height, rng, startx, starty, goalx, goaly);
+	}
+};
+
+// shared by the lattice engines: cells are numbered row by row, cell c is at
+// (2 * (c % across), 2 * (c / across)) in the map
+class lattice_engine : public maze_engine
+{
+public:
+	bool carve(map_buffer& map, int width, int height, maze_rng& rng, int& startx, int& starty, int& goalx, int& goaly) const
+	{
+		lattice g(map, width, height);
+		for (int y = 0; y < height; y++)
+		{
+			memset(&map.at(0, y), 'W', width);
+		}
+		carve_cells(g, rng);
+		startx = 0;
+		starty = 0;
+		goalx = 2 * (g.across - 1);
+		goaly = 2 * (g.down - 1);
+		map.at(startx, starty) = 'S';
+		if (g.across * g.down > 1)
+		{
+			map.at(goalx, goaly) = 'G';
+		}
+		return g.across * g.down > 1;
+	}
+protected:
+	class lattice
+	{
+	public:
+		map_buffer& map;
+		int across;
+		int down;
+		lattice(map_buffer& map, int width, int height) : map(map), across((width + 1) / 2), down((height + 1) / 2) {}
+		size_t cells() const
+		{
+			return (size_t)across * down;
+		}
+		void open_cell(size_t c)
+		{
+			map.at(2 * (int)(c % across), 2 * (int)(c / across)) = '0';
+		}
+		bool is_open(size_t c)
+		{
+			return map.at(2 * (int)(c % across), 2 * (int)(c / across)) != 'W';
+		}
+		// neighbour of c in direction d (see step_x/step_y), false past the edge
+		bool neighbour(size_t c, int d, size_t& n) const
+		{
+			int x = (int)(c % across) + step_x[d], y = (int)(c / across) + step_y[d];
+			if (x < 0 || x >= across || y < 0 || y >= down)
+				return false;
+			n = (size_t)y * across + x;
+			return true;
+		}
+		// open both cells and the wall between them
+		void join(size_t a, size_t b)
+		{
+			int ax = 2 * (int)(a % across), ay = 2 * (int)(a / across);
+			int bx = 2 * (int)(b % across), by = 2 * (int)(b / across);
+			map.at(ax, ay) = '0';
+			map.at(bx, by) = '0';
+			map.at((ax + bx) / 2, (ay + by) / 2) = '0';
+		}
+	};
+	virtual void carve_cells(lattice& g, maze_rng& rng) const = 0;
+};
+
+// depth first with an explicit stack: long winding corridors, few dead ends
+class backtracker_engine : public lattice_engine
+{
+public:
+	const char* name() const { return "backtracker"; }
+protected:
+	void carve_cells(lattice& g, maze_rng& rng) const
+	{
+		std::vector<uint32_t> stack;
+		size_t first = (size_t)rng.below((int)std::min(g.cells(), (size_t)0x7fffffff));
+		g.open_cell(first);
+		stack.push_back((uint32_t)first);
+		while (!stack.empty())
+		{
+			size_t c = stack.back();
+			size_t next[4];
+			int n = 0;
+			for (int d = 0; d < 4; d++)
+			{
+				size_t nb;
+				if (g.neighbour(c, d, nb) && !g.is_open(nb))
+					next[n++] = nb;
+			}
+			if (n == 0)
+			{
+				stack.pop_back();
+				continue;
+			}
+			size_t nb = next[rng.below(n)];
+			g.join(c, nb);
+			stack.push_back((uint32_t)nb);
+		}
+	}
+};
+
+// loop-erased random walks: every perfect maze is equally likely. each walk remembers
+// the way it left a cell, so retracing it afterwards erases the loops for free
+class wilson_engine : public lattice_engine
+{
+public:
+	const char* name() const { return "wilson"; }
+protected:
+	void carve_cells(lattice& g, maze_rng& rng) const
+	{
+		std::vector<uint8_t> way(g.cells(), 0);
+		g.open_cell((size_t)rng.below((int)std::min(g.cells(), (size_t)0x7fffffff)));
+		for (size_t start = 0; start < g.cells(); start++)
+		{
+			if (g.is_open(start))
+				continue;
+			// walk until the maze is hit, overwriting the way out of revisited cells
+			size_t c = start;
+			while (!g.is_open(c))
+			{
+				size_t nb = c;
+				int d;
+				do
+				{
+					d = rng.below(4);
+				} while (!g.neighbour(c, d, nb));
+				way[c] = (uint8_t)d;
+				c = nb;
+			}
+			// add the walk without its loops, up to the maze cell it ended on
+			for (c = start; ; )
+			{
+				size_t nb = c;
+				g.neighbour(c, way[c], nb);
+				bool done = g.is_open(nb);
+				g.join(c, nb);
+				if (done)
+					break;
+				c = nb;
+			}
+		}
+	}
+};
+
+// every wall in random order, opened when it joins two cells not yet connected
+class kruskal_engine : public lattice_engine
+{
+public:
+	const char* name() const { return "kruskal"; }
+protected:
+	void carve_cells(lattice& g, maze_rng& rng) const
+	{
+		std::vector<uint64_t> walls; // cell << 1 | 0 for the one to the right, 1 above
+		walls.reserve(g.cells() * 2);
+		for (size_t c = 0; c < g.cells(); c++)
+		{
+			g.open_cell(c);
+			if ((int)(c % g.across) + 1 < g.across)
+				walls.push_back((uint64_t)c << 1);
+			if ((int)(c / g.across) + 1 < g.down)
+				walls.push_back((uint64_t)c << 1 | 1);
+		}
+		for (size_t i = walls.size(); i > 1; i--) // shuffle
+		{
+			size_t j = (size_t)(rng.next() % i);
+			std::swap(walls[i - 1], walls[j]);
+		}
+		union_find sets(g.cells());
+		for (size_t i = 0; i < walls.size(); i++)
+		{
+			size_t a = (size_t)(walls[i] >> 1);
+			size_t b = (walls[i] & 1) ? a + g.across : a + 1;
+			if (sets.unite((uint32_t)a, (uint32_t)b))
+				g.join(a, b);
+		}
+	}
+};
+
+// every cell opens up or right at random: fast and memoryless, but with a long open
+// corridor along the top and right edges
+class binary_tree_engine : public lattice_engine
+{
+public:
+	const char* name() const { return "binarytree"; }
+protected:
+	void carve_cells(lattice& g, maze_rng& rng) const
+	{
+		for (size_t c = 0; c < g.cells(); c++)
+		{
+			g.open_cell(c);
+			bool up = (int)(c / g.across) + 1 < g.down;
+			bool right = (int)(c % g.across) + 1 < g.across;
+			if (up && (!right || (rng.next() >> 63)))
+				g.join(c, c + g.across);
+			else if (right)
+				g.join(c, c + 1);
+		}
+	}
+};
+
+// row by row runs to the right, each run opens up from one of its cells. only the
+// top row is one long corridor
+class sidewinder_engine : public lattice_engine
+{
+public:
+	const char* name() const { return "sidewinder"; }
+protected:
+	void carve_cells(lattice& g, maze_rng& rng) const
+	{
+		for (int y = 0; y < g.down; y++)
+		{
+			size_t row = (size_t)y * g.across;
+			int runStart = 0;
+			for (int x = 0; x < g.across; x++)
+			{
+				g.open_cell(row + x);
+				bool top = y + 1 == g.down;
+				bool last = x + 1 == g.across;
+				if (top || (!last && (rng.next() >> 63)))
+				{
+					if (!last)
+						g.join(row + x, row + x + 1);
+				}
+				else
+				{
+					int pick = runStart + rng.below(x - runStart + 1);
+					g.join(row + pick, row + pick + g.across);
+					runStart = x + 1;
+				}
+			}
+		}
+	}
+};
+
+// threads for the parallel engine, 0 = all cores
+int carve_threads = 0;
+// chance that two regions already joined get one more opening between them anyway
+// (parallel engine), 0 keeps the maze perfect
+float region_loops = 0;
+
+// one maze carved on all cores: the lattice is cut into regions of REGION_CELLS x
+// REGION_CELLS cells, each region is a backtracker maze of its own made on its own
+// thread, then the regions are joined kruskal style: the borders between them in random
+// order, one opening through a border when it joins two regions not yet connected.
+// trees joined by single edges into a tree of regions is still one perfect maze.
+// the regions don't depend on the thread count, so neither does the maze.
+// corridors never wind across a region border except at the one opening.
+const int REGION_CELLS = 256;
+
+class parallel_engine : public lattice_engine
+{
+public:
+	const char* name() const { return "parallel"; }
+protected:
+	void carve_cells(lattice& g, maze_rng& rng) const
+	{
+		int regionsX = (g.across + REGION_CELLS - 1) / REGION_CELLS;
+		int regionsY = (g.down + REGION_CELLS - 1) / REGION_CELLS;
+		uint64_t regionSeed = rng.next();
+		// regions only touch their own cells and the walls inside them
+		parallelFor(regionsX * regionsY, [&](int r) {
+			maze_rng local(regionSeed, r);
+			carve_region(g, local, (r % regionsX) * REGION_CELLS, (r / regionsX) * REGION_CELLS);
+		}, carve_threads);
+
+		std::vector<uint32_t> borders; // region << 1 | 0 for the one to the right, 1 above
+		for (int r = 0; r < regionsX * regionsY; r++)
+		{
+			if (r % regionsX + 1 < regionsX)
+				borders.push_back((uint32_t)r << 1);
+			if (r / regionsX + 1 < regionsY)
+				borders.push_back((uint32_t)r << 1 | 1);
+		}
+		for (size_t i = borders.size(); i > 1; i--) // shuffle
+		{
+			size_t j = (size_t)(rng.next() % i);
+			std::swap(borders[i - 1], borders[j]);
+		}
+		union_find sets(regionsX * regionsY);
+		for (size_t i = 0; i < borders.size(); i++)
+		{
+			int r = (int)(borders[i] >> 1);
+			bool up = (borders[i] & 1) != 0;
+			int other = up ? r + regionsX : r + 1;
+			if (sets.unite(r, other) || rng.rand01() < region_loops)
+			{
+				// a random cell along the border and the one facing it
+				int x = (r % regionsX) * REGION_CELLS, y = (r / regionsX) * REGION_CELLS;
+				if (up)
+				{
+					x += rng.below(std::min(REGION_CELLS, g.across - x));
+					y += REGION_CELLS - 1;
+				}
+				else
+				{
+					y += rng.below(std::min(REGION_CELLS, g.down - y));
+					x += REGION_CELLS - 1;
+				}
+				size_t c = (size_t)y * g.across + x;
+				g.join(c, up ? c + g.across : c + 1);
+			}
+		}
+	}
+private:
+	// backtracker kept inside the region whose bottom left cell is (x0, y0)
+	static void carve_region(lattice& g, maze_rng& rng, int x0, int y0)
+	{
+		int x1 = std::min(x0 + REGION_CELLS, g.across), y1 = std::min(y0 + REGION_CELLS, g.down);
+		std::vector<uint32_t> stack;
+		size_t first = (size_t)(y0 + rng.below(y1 - y0)) * g.across + x0 + rng.below(x1 - x0);
+		g.open_cell(first);
+		stack.push_back((uint32_t)first);
+		while (!stack.empty())
+		{
+			size_t c = stack.back();
+			int x = (int)(c % g.across), y = (int)(c / g.across);
+			size_t next[4];
+			int n = 0;
+			for (int d = 0; d < 4; d++)
+			{
+				int nx = x + step_x[d], ny = y + step_y[d];
+				size_t nb = (size_t)ny * g.across + nx;
+				if (nx >= x0 && nx < x1 && ny >= y0 && ny < y1 && !g.is_open(nb))
+					next[n++] = nb;
+			}
+			if (n == 0)
+			{
+				stack.pop_back();
+				continue;
+			}
+			size_t nb = next[rng.below(n)];
+			g.join(c, nb);
+			stack.push_back((uint32_t)nb);
+		}
+	}
+};
+
+// all engines, flood first
+const maze_engine* const* maze_engines(int& count)
+{
+	static flood_engine flood;
+	static backtracker_engine backtracker;
+	static wilson_engine wilson;
+	static kruskal_engine kruskal;
+	static binary_tree_engine binaryTree;
+	static sidewinder_engine sidewinder;
+	static parallel_engine parallel;
+	static const maze_engine* const all[] = { &flood, &backtracker, &wilson, &kruskal, &binaryTree, &sidewinder, &parallel };
+	count = (int)(sizeof(all) / sizeof(all[0]));
+	return all;
+}
+
+// NULL if there is no engine called name
+const maze_engine* find_engine(const char* name)
+{
+	int count;
+	const maze_engine* const* all = maze_engines(count);
+	for (int i = 0; i < count; i++)
+	{
+		if (strcmp(all[i]->name(), name) == 0)
+			return all[i];
+	}
+	return NULL;
+}
+
+// carve a maze with engine into map, or straight into fileName when there is one, and
+// put the keys in. false (with a message) when the map can't be made or is too small
+// for a goal
+bool generate_maze(const maze_engine& engine, map_buffer& map, int width, int height, int keys, maze_rng& rng, const char* fileName = NULL)
+{
+	if (!map.create(width, height, fileName))
+	{
+		fprintf(stderr, "Can't make a %d x %d map\n", width, height);
+		return false;
+	}
+	int startx, starty, goalx, goaly;
+	if (!engine.carve(map, width, height, rng, startx, starty, goalx, goaly))
+	{
+		fprintf(stderr, "No room for a goal in a %d x %d %s maze\n", width, height, engine.name());
+		return false;
+	}
+	spawn_keys(map, width, height, keys, startx, starty, goalx, goaly, rng);
+	return true;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "parse.h"
+// distance to the goal and the way to go from every open cell, for anything that asks
+// "which way to the goal" every frame (hints, chasers, autoplay): a lookup, no search.
+// made once by a BFS out from the goal. closed doors count as walls, when one opens
+// (collision in gameplay.h calls doorOpened) only the cells that are now closer to the
+// goal are walked again, from the door outwards, the rest of the field stays as it is.
+// 5 bytes a cell, paged maps don't get one (see buildFlowField in gameplay.h).
+const uint32_t FLOW_UNREACHED = 0xffffffffu;
+const uint8_t FLOW_NONE = 4; // the goal itself, or no way there
+const int flowStepX[4] = { 0, 0, -1, 1 }; // up, down, left, right
+const int flowStepY[4] = { 1, -1, 0, 0 };
+
+class FlowField {
+public:
+	int width = 0;
+	int height = 0;
+	std::vector<uint32_t> dist; // steps to the goal, y * width + x
+	std::vector<uint8_t> next;  // direction of the next step (flowStepX/Y), FLOW_NONE if none
+
+	void build(const MazeInstance& maze)
+	{
+		const Grid& grid = maze.grid;
+		width = grid.width;
+		height = grid.height;
+		size_t cells = (size_t)width * height;
+		dist.assign(cells, FLOW_UNREACHED);
+		next.assign(cells, FLOW_NONE);
+		closedDoors.assign((cells + 63) / 64, 0);
+		for (size_t i = 0; i < maze.player.doors.size(); i++)
+		{
+			const Door& door = maze.player.doors[i];
+			if (door.door != 0 && !door.open && grid.inside(door.doorx, door.doory))
+			{
+				size_t c = (size_t)door.doory * width + door.doorx;
+				closedDoors[c >> 6] |= (uint64_t)1 << (c & 63);
+			}
+		}
+		int goalx = maze.player.goalx, goaly = maze.player.goaly;
+		if (!open(grid, goalx, goaly))
+			return;
+		size_t goal = (size_t)goaly * width + goalx;
+		dist[goal] = 0;
+		std::vector<size_t> queue(1, goal);
+		spread(grid, queue);
+	}
+	// door i was opened: walk out from it over the cells it brings closer to the goal
+	void doorOpened(const MazeInstance& maze, int door)
+	{
+		const Grid& grid = maze.grid;
+		int x = maze.player.doors[door].doorx, y = maze.player.doors[door].doory;
+		if (!grid.inside(x, y) || grid.width != width || grid.height != height)
+			return;
+		size_t c = (size_t)y * width + x;
+		closedDoors[c >> 6] &= ~((uint64_t)1 << (c & 63));
+		if (!open(grid, x, y))
+			return;
+		for (int d = 0; d < 4; d++)
+		{
+			uint32_t through = distance(x + flowStepX[d], y + flowStepY[d]);
+			if (through != FLOW_UNREACHED && through + 1 < dist[c])
+			{
+				dist[c] = through + 1;
+				next[c] = (uint8_t)d;
+			}
+		}
+		if (dist[c] == FLOW_UNREACHED) // opens onto cells that can't reach the goal either
+			return;
+		std::vector<size_t> queue(1, c);
+		spread(grid, queue);
+	}
+	uint32_t distance(int x, int y) const
+	{
+		if (x < 0 || y < 0 || x >= width || y >= height)
+			return FLOW_UNREACHED;
+		return dist[(size_t)y * width + x];
+	}
+	// direction of the next step towards the goal, FLOW_NONE on the goal, walls and cells
+	// with no way there
+	int direction(int x, int y) const
+	{
+		if (x < 0 || y < 0 || x >= width || y >= height)
+			return FLOW_NONE;
+		return next[(size_t)y * width + x];
+	}
+private:
+	std::vector<uint64_t> closedDoors; // one bit a cell
+
+	bool open(const Grid& grid, int x, int y) const
+	{
+		if (!grid.inside(x, y))
+			return false;
+		size_t c = (size_t)y * width + x;
+		if ((closedDoors[c >> 6] >> (c & 63)) & 1)
+			return false;
+		return grid.wordsPerRow > 0 ? !((grid.row(y)[x >> 6] >> (x & 63)) & 1) : !grid.isWall(x, y);
+	}
+	// BFS from the cells in queue (their dist already set) to every open cell it makes
+	// closer. all queued cells are one step further than the one taken off, so the
+	// first time a cell is improved is the last
+	void spread(const Grid& grid, std::vector<size_t>& queue)
+	{
+		for (size_t i = 0; i < queue.size(); i++)
+		{
+			size_t c = queue[i];
+			int x = (int)(c % width), y = (int)(c / width);
+			uint32_t further = dist[c] + 1;
+			for (int d = 0; d < 4; d++)
+			{
+				int nx = x + flowStepX[d], ny = y + flowStepY[d];
+				if (!open(grid, nx, ny))
+					continue;
+				size_t n = (size_t)ny * width + nx;
+				if (further < dist[n])
+				{
+					dist[n] = further;
+					next[n] = (uint8_t)(d ^ 1); // back the way we came: up <-> down, left <-> right
+					queue.push_back(n);
+				}
+			}
+		}
+	}
+};
@@ -0,0 +1,135 @@
+#pragma once
+#include <math.h>
+#include "parse.h"
+#include "flowfield.h"
+// game rules that do not need a window: walking into walls, doors, keys and the goal.
+// everything works on the MazeInstance it is given, so headless simulations can run
+// many mazes side by side.
+
+// maps up to this many cells get a flow field, 5 bytes a cell
+size_t flowFieldMaxCells = 64 << 20;
+
+// (re)make the flow field after a map is loaded or reloaded. paged maps and maps past
+// flowFieldMaxCells go without, maze.flow is NULL then
+void buildFlowField(MazeInstance& maze)
+{
+	if (maze.grid.tiles || (size_t)maze.grid.width * maze.grid.height > flowFieldMaxCells)
+	{
+		maze.flow.reset();
+		return;
+	}
+	if (!maze.flow)
+		maze.flow = std::make_shared<FlowField>();
+	maze.flow->build(maze);
+}
+
+// carried keys follow the player
+void move_key(MazeInstance& maze, float x, float y,float viewx, float viewy)
+{
+	float keypos = 0;
+	for (size_t k = 0; k < maze.player.carried.size(); k++) // only the keys we hold move with us
+	{
+		int i = maze.player.carried[k];
+		maze.player.doors[i].keyx += x * viewx;
+		maze.player.doors[i].keyy += y * viewy;
+		if (keypos == 1)
+		{
+			maze.player.doors[i].keyz = 0.3;
+		}
+		else if (keypos == 2)
+		{
+			maze.player.doors[i].keyz = -0.3;
+		}
+		else if (keypos == 3)
+		{
+			maze.player.doors[i].keyz = 0.6;
+		}
+		else if (keypos == 4)
+		{
+			maze.player.doors[i].keyz = -0.6;
+		}
+		keypos++;
+	}
+}
+// collision for door/key/wall
+bool collision(MazeInstance& maze, float x, float y)
+{ 
+	//check for wall, only the (at most 2x2) cells closer than 0.75 can be hit
+	int x0 = (int)floor(x - 0.75) + 1, x1 = (int)ceil(x + 0.75) - 1;
+	int y0 = (int)floor(y - 0.75) + 1, y1 = (int)ceil(y + 0.75) - 1;
+	for (int i = x0; i <= x1; i++)
+	{
+		for (int j = y0; j <= y1; j++)
+		{
+			if (maze.grid.isWall(i, j)) // collide with wall (or the border)
+			{
+				return true;
+			}
+		}
+	}
+
+	// check for door, the grid says which door (if any) is on the cells within reach
+	x0 = (int)floor(x - 1) + 1, x1 = (int)ceil(x + 1) - 1;
+	y0 = (int)floor(y - 1) + 1, y1 = (int)ceil(y + 1) - 1;
+	for (int i = x0; i <= x1; i++)
+	{
+		for (int j = y0; j <= y1; j++)
+		{
+			const Entity* e = maze.grid.entity(i, j);
+			if (e == NULL || e->type != CELL_DOOR || maze.player.doors[e->index].open)
+			{
+				continue;
+			}
+			if (maze.player.doors[e->index].have_key)
+			{
+				maze.player.doors[e->index].open = true; // if have the key, open the door
+				if (maze.flow)
+					maze.flow->doorOpened(maze, e->index);
+				return false;
+			}
+			else
+			{
+				return true; // collide with door
+			}
+		}
+	}
+	
+	// check for key, only the nearest cell can hold a key closer than 0.5
+	const Entity* e = maze.grid.entity((int)floor(x + 0.5), (int)floor(y + 0.5));
+	if (e != NULL && e->type == CELL_KEY && !maze.player.doors[e->index].have_key)
+	{
+		Door& door = maze.player.doors[e->index];
+		float dis = sqrt(pow(x - door.keyx, 2) + pow(y - door.keyy, 2));
+		if (dis < 0.5) // collide with key
+		{
+			door.have_key = true;
+			maze.player.carried.push_back(e->index);
+		}
+	}
+	
+	// check for goal
+	float dis = sqrt(pow(x - maze.player.goalx, 2) + pow(y - maze.player.goaly, 2));
+	if (dis < 0.5) // reach the goal, reload the game
+	{
+		maze.player.goal = true;
+		maze.player.Playerx = maze.player.startx;
+		maze.player.Playery = maze.player.starty;
+		for (size_t i = 0; i < maze.player.doors.size(); i++)
+		{
+			maze.player.doors[i].open = false;
+			maze.player.doors[i].have_key = false;
+		}
+		// put the keys we carried around back where the map has them
+		for (size_t i = 0; i < maze.player.carried.size(); i++)
+		{
+			Door& door = maze.player.doors[maze.player.carried[i]];
+			door.keyx = door.keyhomex;
+			door.keyy = door.keyhomey;
+			door.keyz = 0;
+		}
+		maze.player.carried.clear();
+		if (maze.flow) // the doors are shut again
+			maze.flow->build(maze);
+	}
+	return false;
+}
@@ -0,0 +1,483 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include "mapformat.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+// maze generator used by map.cpp: carves a random maze into a buffer that is already
+// in the map file format parseMapFile reads. everything a maze needs is local to
+// the carve and its maze_rng, so any number of them can be made at once. the carving
+// engines and generate_maze, which puts it all together, are in engines.h.
+float way3_2 = 0.5;
+float way3_1 = 0.6;
+float way3_0 = 0.33;
+
+float way2_1 = 0.5;
+float way2_0 = 0.5;
+
+float way1_0 = 0.75;
+float half = 0.5;
+bool debug_steps = false; // dump the maze after every step
+
+// random numbers for one maze. xoshiro256** seeded through splitmix64 from the seed
+// and the maze number, so maze i of seed s comes out the same on every platform and
+// whichever thread makes it.
+class maze_rng
+{
+public:
+	maze_rng(uint64_t seed, uint64_t stream = 0)
+	{
+		uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ull);
+		for (int i = 0; i < 4; i++)
+		{
+			s[i] = splitmix64(x);
+		}
+	}
+	uint64_t next()
+	{
+		uint64_t result = rotl(s[1] * 5, 7) * 9;
+		uint64_t t = s[1] << 17;
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 45);
+		return result;
+	}
+	// 0 <= result < 1
+	float rand01()
+	{
+		return (next() >> 40) * (1.0f / 16777216.0f);
+	}
+	// 0 <= result < n
+	int below(int n)
+	{
+		return (int)(((next() >> 32) * (uint64_t)n) >> 32);
+	}
+private:
+	uint64_t s[4];
+	static uint64_t rotl(uint64_t x, int k)
+	{
+		return (x << k) | (x >> (64 - k));
+	}
+	static uint64_t splitmix64(uint64_t& x)
+	{
+		uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+};
+
+// the way a block was entered, the carving carries on from there
+enum Direction { UP, DOWN, LEFT, RIGHT };
+const int step_x[4] = { 0, 0, -1, 1 };
+const int step_y[4] = { 1, -1, 0, 0 };
+// forward, then the two sides: every way out of a block but the one it came from
+const Direction ways[4][3] = {
+	{ UP, LEFT, RIGHT },    // up
+	{ DOWN, LEFT, RIGHT },  // down
+	{ LEFT, UP, DOWN },     // left
+	{ RIGHT, UP, DOWN },    // right
+};
+class block
+{
+public:
+	int x;
+	int y;
+	Direction type;
+	block(int x, int y, Direction type)
+	{
+		this->x = x;
+		this->y = y;
+		this->type = type;
+	}
+};
+// the map being carved, kept in the map file layout ("width height" line, then the rows
+// top row first) so it is written out as is. with a file name the buffer is the file
+// itself, mmap'd, which is how mazes bigger than memory are made.
+class map_buffer
+{
+public:
+	char* data = NULL;
+	size_t size = 0;
+	size_t header = 0;
+	bool mapped = false;
+	map_buffer() {}
+	~map_buffer()
+	{
+		release();
+	}
+	bool create(int width, int height, const char* fileName)
+	{
+		release();
+		this->width = width;
+		this->height = height;
+		char line[32];
+		header = sprintf(line, "%d %d\n", width, height);
+		size = header + (size_t)(width + 1) * height;
+#ifndef _WIN32
+		if (fileName != NULL)
+		{
+			int fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+			if (fd < 0 || ftruncate(fd, (off_t)size) != 0)
+			{
+				if (fd >= 0)
+					close(fd);
+				return false;
+			}
+			void* addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			close(fd);
+			if (addr == MAP_FAILED)
+			{
+				return false;
+			}
+			data = (char*)addr;
+			mapped = true;
+		}
+		else
+#endif
+		{
+			data = (char*)malloc(size);
+			if (data == NULL)
+			{
+				return false;
+			}
+		}
+		memcpy(data, line, header);
+		for (int j = 0; j < height; j++)
+		{
+			char* row = data + header + (size_t)j * (width + 1);
+			memset(row, '0', width);
+			row[width] = '\n';
+		}
+		return true;
+	}
+	// y goes up, the file rows go down
+	char& at(int x, int y)
+	{
+		return data[header + (size_t)(height - 1 - y) * (width + 1) + x];
+	}
+	// the rows only, for the step by step dumps
+	void dump(FILE* out)
+	{
+		fwrite(data + header, 1, size - header, out);
+		fputc('\n', out);
+	}
+	// write a heap buffer to a file in one go (a mapped one is already there)
+	bool save(const char* fileName)
+	{
+		if (mapped)
+		{
+			return true;
+		}
+		FILE* out = fopen(fileName, "wb");
+		if (out == NULL)
+		{
+			return false;
+		}
+		bool ok = write(out);
+		return fclose(out) == 0 && ok;
+	}
+	bool write(FILE* out)
+	{
+		return fwrite(data, 1, size, out) == size;
+	}
+	void release()
+	{
+#ifndef _WIN32
+		if (mapped)
+		{
+			munmap(data, size);
+		}
+		else
+#endif
+		free(data);
+		data = NULL;
+		mapped = false;
+	}
+private:
+	int width = 0;
+	int height = 0;
+	map_buffer(const map_buffer&);
+	map_buffer& operator=(const map_buffer&);
+};
+// door and key letters of pair k, only letters so every pair fits in one cell
+const char* const door_letters = "ABCDEFHIJKLMNOPQRTUVXYZ";
+const char* const key_letters = "abcdefhijklmnopqrtuvxyz";
+const int max_keys = MAX_KEY_PAIRS; // fewer than there are letters, see mapformat.h
+
+// put up to keys door/key pairs into a carved maze so it can always be finished.
+// the doors go on the path from the start to the goal, in order. then one flood fill
+// from the start grows the reachable area door by door: key k goes somewhere in what
+// was reached with doors k and up still shut (the newly reached part if it can),
+// then door k is opened and the flood carries on from it. every cell is visited at
+// most twice (the path search and the flood), so this is linear in the maze size.
+// returns how many pairs were placed.
+int spawn_keys(map_buffer& map, int width, int height, int keys, int startx, int starty, int goalx, int goaly, maze_rng& rng)
+{
+	if (keys > max_keys)
+		keys = max_keys;
+	if (keys <= 0)
+		return 0;
+	size_t cells = (size_t)width * height;
+	size_t start = (size_t)starty * width + startx;
+	size_t goal = (size_t)goaly * width + goalx;
+
+	// shortest path start -> goal, each cell remembers the way it was entered
+	const uint8_t UNSEEN = 255;
+	std::vector<uint8_t> from(cells, UNSEEN);
+	std::vector<size_t> queue;
+	queue.push_back(start);
+	from[start] = 0;
+	for (size_t head = 0; head < queue.size() && from[goal] == UNSEEN; head++)
+	{
+		int x = (int)(queue[head] % width), y = (int)(queue[head] / width);
+		for (int d = 0; d < 4; d++)
+		{
+			int nx = x + step_x[d], ny = y + step_y[d];
+			if (nx < 0 || nx >= width || ny < 0 || ny >= height || map.at(nx, ny) == 'W')
+				continue;
+			size_t next = (size_t)ny * width + nx;
+			if (from[next] == UNSEEN)
+			{
+				from[next] = (uint8_t)d;
+				queue.push_back(next);
+			}
+		}
+	}
+	if (from[goal] == UNSEEN)
+		return 0;
+	std::vector<size_t> path; // goal first
+	for (size_t c = goal; c != start; )
+	{
+		path.push_back(c);
+		int d = from[c];
+		c = (size_t)((int)(c / width) - step_y[d]) * width + (size_t)((int)(c % width) - step_x[d]);
+	}
+	path.push_back(start);
+	std::vector<uint8_t>().swap(from);
+	int inner = (int)path.size() - 2; // path cells that are not the start or the goal
+	if (keys > inner)
+		keys = inner;
+	if (keys <= 0)
+		return 0;
+
+	// doors spread evenly along the path, door 0 nearest the start
+	std::vector<size_t> doors(keys);
+	for (int k = 0; k < keys; k++)
+	{
+		doors[k] = path[path.size() - 1 - (size_t)(k + 1) * (inner + 1) / (keys + 1)];
+		map.at((int)(doors[k] % width), (int)(doors[k] / width)) = door_letters[k];
+	}
+
+	// grow the reachable area one door at a time
+	std::vector<uint64_t> reached((cells + 63) / 64, 0);
+	auto reach = [&](size_t c) {
+		reached[c >> 6] |= (uint64_t)1 << (c & 63);
+		queue.push_back(c);
+	};
+	auto flood = [&](size_t head) {
+		for (; head < queue.size(); head++)
+		{
+			int x = (int)(queue[head] % width), y = (int)(queue[head] / width);
+			for (int d = 0; d < 4; d++)
+			{
+				int nx = x + step_x[d], ny = y + step_y[d];
+				if (nx < 0 || nx >= width || ny < 0 || ny >= height)
+					continue;
+				size_t next = (size_t)ny * width + nx;
+				char c = map.at(nx, ny);
+				if ((reached[next >> 6] >> (next & 63)) & 1 || c == 'W' || (c >= 'A' && c <= 'Z' && c != 'S' && c != 'G'))
+					continue;
+				reach(next);
+			}
+		}
+	};
+	queue.clear();
+	reach(start);
+	flood(0);
+	size_t regionStart = 0;
+	int placed = 0;
+	for (int k = 0; k < keys; k++)
+	{
+		// a free cell, from the part reached since the last door if there is one
+		size_t key = cells;
+		for (int tries = 0; tries < 2 && key == cells; tries++)
+		{
+			size_t first = tries == 0 ? regionStart : 0;
+			size_t count = queue.size() - first;
+			for (size_t i = 0; i < count && key == cells; i++)
+			{
+				size_t c = queue[first + (rng.below((int)std::min(count, (size_t)0x7fffffff)) + i) % count];
+				if (map.at((int)(c % width), (int)(c / width)) == '0')
+					key = c;
+			}
+		}
+		int doorx = (int)(doors[k] % width), doory = (int)(doors[k] / width);
+		if (key == cells) // nowhere to put it, leave the door out
+		{
+			map.at(doorx, doory) = '0';
+		}
+		else
+		{
+			map.at((int)(key % width), (int)(key / width)) = key_letters[placed];
+			map.at(doorx, doory) = door_letters[placed];
+			placed++;
+		}
+		regionStart = queue.size();
+		size_t head = queue.size();
+		reach(doors[k]);
+		flood(head);
+	}
+	return placed;
+}
+// one of three, the first a third of the time, then half and half
+int pick3(maze_rng& rng)
+{
+	if (rng.rand01() <= 0.33)
+		return 0;
+	return rng.rand01() <= 0.5 ? 1 : 2;
+}
+// the original probabilistic flood: carve into map (fresh from map.create, all '0'),
+// mark the start and the goal. false if no goal could be placed
+bool carve_flood(map_buffer& map, int width, int height, maze_rng& rng, int& startx, int& starty, int& goalx, int& goaly)
+{
+	// frontier, first in first out
+	std::queue<block> blocks;
+	// one bit per cell, set once a cell has been opened (queued as a path)
+	std::vector<uint64_t> allzeors(((size_t)width * height + 63) / 64, 0);
+	auto is_open = [&](int x, int y) {
+		size_t i = (size_t)y * width + x;
+		return ((allzeors[i >> 6] >> (i & 63)) & 1) != 0;
+	};
+	auto open_block = [&](int x, int y, Direction type) {
+		size_t i = (size_t)y * width + x;
+		allzeors[i >> 6] |= (uint64_t)1 << (i & 63);
+		blocks.push(block(x, y, type));
+	};
+	// a wall can go anywhere that was not opened before
+	auto spawn_walls = [&](int x, int y) {
+		return !is_open(x, y);
+	};
+
+	startx = rng.below(width);
+	starty = rng.below(height);
+	if (debug_steps)
+	{
+		fprintf(stderr, "start %d %d\n", startx, starty);
+	}
+	map.at(startx, starty) = 'S';
+	open_block(startx, starty, UP);
+	blocks.pop(); // the start is open but not carved from
+	for (int d = 0; d < 4; d++)
+	{
+		int x = startx + step_x[d];
+		int y = starty + step_y[d];
+		if (x >= 0 && x < width && y >= 0 && y < height)
+		{
+			open_block(x, y, (Direction)d);
+		}
+	}
+
+	while (blocks.size() > 1)
+	{
+		block current = blocks.front();
+		blocks.pop();
+		int x = current.x;
+		int y = current.y;
+
+		// the ways out that are still free
+		int ava_x[3], ava_y[3];
+		Direction ava_type[3];
+		int ava_block = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			Direction d = ways[current.type][k];
+			int nx = x + step_x[d];
+			int ny = y + step_y[d];
+			if (nx >= 0 && nx < width && ny >= 0 && ny < height && map.at(nx, ny) == '0' && !is_open(nx, ny))
+			{
+				ava_x[ava_block] = nx;
+				ava_y[ava_block] = ny;
+				ava_type[ava_block] = d;
+				ava_block++;
+			}
+		}
+		if (ava_block == 0) // no avaliable block
+		{
+			continue;
+		}
+
+		// which of them stay open, the rest become walls
+		bool keep[3] = { false, false, false };
+		if (ava_block == 1)
+		{
+			keep[0] = rng.rand01() <= way1_0; // save it or block it
+		}
+		else if (ava_block == 2)
+		{
+			if (rng.rand01() <= way2_1) // +1 both ava
+			{
+				keep[0] = keep[1] = true;
+			}
+			else if (rng.rand01() <= way2_0) // 0: one of them ava
+			{
+				keep[rng.rand01() >= 0.5 ? 0 : 1] = true;
+			}
+			// -1 both blocked
+		}
+		else
+		{
+			if (rng.rand01() <= way3_2) // +2 block 0 way
+			{
+				keep[0] = keep[1] = keep[2] = true;
+			}
+			else if (rng.rand01() <= way3_1) // +1 random block one way
+			{
+				keep[0] = keep[1] = keep[2] = true;
+				keep[pick3(rng)] = false;
+			}
+			else if (rng.rand01() <= way3_0) // -1  block all ways
+			{
+			}
+			else // 0  block two ways
+			{
+				keep[pick3(rng)] = true;
+			}
+		}
+		for (int k = 0; k < ava_block; k++)
+		{
+			if (keep[k])
+			{
+				open_block(ava_x[k], ava_y[k], ava_type[k]);
+			}
+			else if (spawn_walls(ava_x[k], ava_y[k]))
+			{
+				map.at(ava_x[k], ava_y[k]) = 'W';
+			}
+		}
+
+		if (debug_steps)
+		{
+			map.dump(stderr);
+		}
+	}
+	if (blocks.empty())
+	{
+		return false;
+	}
+	goalx = blocks.front().x;
+	goaly = blocks.front().y;
+	map.at(goalx, goaly) = 'G';
+	return true;
+}
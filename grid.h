@@ -0,0 +1,264 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include "mapfile.h"
+#include "tilestore.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+// the map as a dense grid.
+// walls are one bit per cell, every row starts on a new 64 bit word so a row can be
+// walked (or copied, or compared) a word at a time. a 10k x 10k map is ~12 MB.
+// doors, keys, start and goal are rare, they live in a small hash table keyed by cell.
+// the wall bits can also be a view straight into a mapped binary map (see mapbin.h),
+// they are only copied out if something writes to them.
+// for maps too big for memory the walls stay on disk in a TileStore instead, such a
+// grid only answers isWall / cell / entity (there are no rows to walk).
+// anything outside the map counts as wall, that is the border around the maze.
+enum CellType { CELL_EMPTY = 0, CELL_WALL, CELL_DOOR, CELL_KEY, CELL_START, CELL_GOAL };
+
+inline int lowestBit(uint64_t word)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return (int)index;
+#else
+	return __builtin_ctzll(word);
+#endif
+}
+
+inline int countBits(uint64_t word)
+{
+#ifdef _MSC_VER
+	return (int)__popcnt64(word);
+#else
+	return __builtin_popcountll(word);
+#endif
+}
+
+class Entity {
+public:
+	int type;  // CELL_DOOR, CELL_KEY, CELL_START or CELL_GOAL
+	int index; // for doors and keys: which entry of player.doors
+	Entity(int type = CELL_EMPTY, int index = -1)
+	{
+		this->type = type;
+		this->index = index;
+	}
+};
+
+class Grid {
+public:
+	int width = 0;
+	int height = 0;
+	int wordsPerRow = 0;
+	std::vector<uint64_t> wallBits;        // our own copy of the bits, empty while viewing a file
+	const uint64_t* mappedBits = NULL;     // or the bits inside a mapped file
+	std::shared_ptr<MappedFile> mapping;   // keeps that file mapped as long as we look at it
+	std::shared_ptr<TileStore> tiles;      // or the walls are paged in from disk
+	std::unordered_map<uint64_t, Entity> entities;
+
+	// a number that stays the same as long as the walls do (copies included), for
+	// things built from the walls to tell they are out of date. walls written through
+	// setWall count, anything that writes row() words itself has to go through it too
+	uint64_t wallVersion() const
+	{
+		static std::atomic<uint64_t> versions(0);
+		uint64_t version = wallStamp.value.load();
+		if (version == 0)
+		{
+			uint64_t fresh = ++versions;
+			version = wallStamp.value.compare_exchange_strong(version, fresh) ? fresh : version;
+		}
+		return version;
+	}
+	void resize(int width, int height)
+	{
+		setSize(width, height);
+		mappedBits = NULL;
+		mapping.reset();
+		tiles.reset();
+		wallBits.assign(wordCount(), 0);
+		entities.clear();
+	}
+	// use wall bits that live in a mapped file instead of allocating our own
+	void view(std::shared_ptr<MappedFile> file, const uint64_t* bits, int width, int height)
+	{
+		setSize(width, height);
+		wallBits.clear();
+		mappedBits = bits;
+		mapping = file;
+		tiles.reset();
+		entities.clear();
+	}
+	// walls come from a tiled map on disk
+	void page(std::shared_ptr<TileStore> store)
+	{
+		setSize(store->width, store->height);
+		wordsPerRow = 0; // no rows in memory
+		wallBits.clear();
+		mappedBits = NULL;
+		mapping.reset();
+		tiles = store;
+		entities.clear();
+	}
+	// make our own copy before the first write to mapped bits
+	void detach()
+	{
+		if (mappedBits != NULL)
+		{
+			wallBits.assign(mappedBits, mappedBits + wordCount());
+			mappedBits = NULL;
+			mapping.reset();
+		}
+	}
+	size_t wordCount() const
+	{
+		return (size_t)wordsPerRow * height;
+	}
+	const uint64_t* words() const
+	{
+		return mappedBits != NULL ? mappedBits : wallBits.data();
+	}
+	bool inside(int x, int y) const
+	{
+		return x >= 0 && y >= 0 && x < width && y < height;
+	}
+	uint64_t cellKey(int x, int y) const
+	{
+		return (uint64_t)y * (uint64_t)width + (uint64_t)x;
+	}
+	const uint64_t* row(int y) const
+	{
+		return words() + (size_t)y * wordsPerRow;
+	}
+	uint64_t* row(int y)
+	{
+		detach();
+		return wallBits.data() + (size_t)y * wordsPerRow;
+	}
+	bool isWall(int x, int y) const
+	{
+		if (!inside(x, y))
+		{
+			return true;
+		}
+		if (tiles)
+		{
+			return tiles->isWall(x, y);
+		}
+		return (row(y)[x >> 6] >> (x & 63)) & 1;
+	}
+	// safe from several threads on different rows (parseMapBufferParallel)
+	void setWall(int x, int y, bool wall)
+	{
+		// only the first write after wallVersion stores, the rest just read the stamp, so
+		// parse workers don't fight over its cache line
+		if (wallStamp.value.load(std::memory_order_relaxed) != 0)
+			wallStamp.value.store(0, std::memory_order_relaxed);
+		uint64_t bit = (uint64_t)1 << (x & 63);
+		if (wall)
+			row(y)[x >> 6] |= bit;
+		else
+			row(y)[x >> 6] &= ~bit;
+	}
+	void setEntity(int x, int y, int type, int index = -1)
+	{
+		entities[cellKey(x, y)] = Entity(type, index);
+	}
+	// returns NULL when there is nothing special on the cell
+	const Entity* entity(int x, int y) const
+	{
+		if (entities.empty() || !inside(x, y))
+		{
+			return NULL;
+		}
+		std::unordered_map<uint64_t, Entity>::const_iterator it = entities.find(cellKey(x, y));
+		return it == entities.end() ? NULL : &it->second;
+	}
+	int cell(int x, int y) const
+	{
+		if (isWall(x, y))
+		{
+			return CELL_WALL;
+		}
+		const Entity* e = entity(x, y);
+		return e ? e->type : CELL_EMPTY;
+	}
+	size_t wallCount() const
+	{
+		size_t count = 0;
+		const uint64_t* bits = words();
+		for (size_t i = 0; i < wordCount(); i++)
+		{
+			count += countBits(bits[i]);
+		}
+		return count;
+	}
+	// calls fn(x, y) for every wall cell in the box x0..x1, y0..y1 (inclusive, clipped to
+	// the map). works for paged maps too, this is what rendering uses.
+	template <class Fn>
+	void forEachWallIn(int x0, int y0, int x1, int y1, Fn fn) const
+	{
+		x0 = x0 < 0 ? 0 : x0;
+		y0 = y0 < 0 ? 0 : y0;
+		x1 = x1 >= width ? width - 1 : x1;
+		y1 = y1 >= height ? height - 1 : y1;
+		for (int y = y0; y <= y1; y++)
+		{
+			for (int x = x0; x <= x1; x++)
+			{
+				if (isWall(x, y))
+				{
+					fn(x, y);
+				}
+			}
+		}
+	}
+	// calls fn(x, y) for every wall inside the map, a row at a time
+	template <class Fn>
+	void forEachWall(Fn fn) const
+	{
+		for (int y = 0; y < height; y++)
+		{
+			const uint64_t* rowBits = row(y);
+			for (int w = 0; w < wordsPerRow; w++)
+			{
+				uint64_t bits = rowBits[w];
+				while (bits)
+				{
+					fn(w * 64 + lowestBit(bits), y);
+					bits &= bits - 1;
+				}
+			}
+		}
+	}
+private:
+	// 0 once the walls changed, wallVersion hands out a new one. atomic as setWall runs
+	// on parse workers, copied like the rest of the grid
+	class Stamp {
+	public:
+		mutable std::atomic<uint64_t> value;
+		Stamp() : value(0) {}
+		Stamp(const Stamp& other) : value(other.value.load()) {}
+		Stamp& operator=(const Stamp& other)
+		{
+			value = other.value.load();
+			return *this;
+		}
+	};
+	Stamp wallStamp;
+
+	void setSize(int width, int height)
+	{
+		wallStamp.value = 0;
+		this->width = width > 0 ? width : 0;
+		this->height = height > 0 ? height : 0;
+		wordsPerRow = (this->width + 63) / 64;
+	}
+};
@@ -0,0 +1,203 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <chrono>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+#include "parse.h"
+// map hot reload for level editing: watch the map file, and when it is saved re-parse
+// only that file, diff it against the running maze and patch the maze in place.
+// models, textures and shaders are left alone, and walls are drawn straight from the
+// grid every frame, so there is no other geometry to rebuild.
+
+// tells when a map file was written. inotify on linux (on the directory, editors often
+// save by renaming a temp file over the map), polling the modification time elsewhere.
+class MapWatcher {
+public:
+	~MapWatcher()
+	{
+#ifdef __linux__
+		if (fd >= 0)
+			close(fd);
+#endif
+	}
+	bool watch(const std::string& fileName)
+	{
+		this->fileName = fileName;
+		size_t slash = fileName.find_last_of("/\\");
+		std::string dir = slash == std::string::npos ? "." : fileName.substr(0, slash);
+		baseName = slash == std::string::npos ? fileName : fileName.substr(slash + 1);
+		lastTime = modifiedTime();
+#ifdef __linux__
+		fd = inotify_init1(IN_NONBLOCK);
+		if (fd >= 0 && inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) >= 0)
+		{
+			return true;
+		}
+		if (fd >= 0)
+			close(fd);
+		fd = -1; // fall back to polling
+#endif
+		return true;
+	}
+	// cheap enough to call every frame, never blocks
+	bool changed()
+	{
+#ifdef __linux__
+		if (fd >= 0)
+		{
+			bool hit = false;
+			char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+			ssize_t length;
+			while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+			{
+				for (char* p = buffer; p < buffer + length; p += sizeof(struct inotify_event) + ((struct inotify_event*)p)->len)
+				{
+					struct inotify_event* event = (struct inotify_event*)p;
+					if (event->len > 0 && baseName == event->name)
+					{
+						hit = true;
+					}
+				}
+			}
+			return hit;
+		}
+#endif
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now - lastPoll < std::chrono::milliseconds(250))
+		{
+			return false;
+		}
+		lastPoll = now;
+		long long time = modifiedTime();
+		if (time != lastTime)
+		{
+			lastTime = time;
+			return true;
+		}
+		return false;
+	}
+private:
+	std::string fileName;
+	std::string baseName;
+	long long lastTime = 0;
+	std::chrono::steady_clock::time_point lastPoll;
+#ifdef __linux__
+	int fd = -1;
+#endif
+	long long modifiedTime() const
+	{
+		struct stat info;
+		if (stat(fileName.c_str(), &info) != 0)
+			return 0;
+		return (long long)info.st_mtime;
+	}
+};
+
+// what a reload changed
+class MapDiff {
+public:
+	bool resized = false;       // the size changed, the whole grid was replaced
+	vector<pair<int, int> > addedWalls;
+	vector<pair<int, int> > removedWalls;
+	int doorsAdded = 0;
+	int doorsRemoved = 0;
+	int doorsMoved = 0; // door or key of an existing pair moved
+};
+
+// re-parse fileName and bring maze up to date with it.
+// walls are diffed a 64-bit word at a time and only the changed bits are touched.
+// door/key pairs are matched by tag, so opened doors and picked up keys stay that way.
+bool reloadMap(MazeInstance& maze, const std::string& fileName, MapDiff& diff)
+{
+	diff = MapDiff();
+	MazeInstance fresh;
+	fresh.width = -1;
+	parseMapFile(fresh, fileName);
+	if (fresh.width < 0 || fresh.grid.tiles || maze.grid.tiles) // unreadable, or a paged map
+	{
+		if (fresh.width < 0)
+			return false;
+		diff.resized = true;
+	}
+	if (fresh.grid.width != maze.grid.width || fresh.grid.height != maze.grid.height)
+	{
+		diff.resized = true;
+	}
+
+	if (diff.resized)
+	{
+		maze.width = fresh.width;
+		maze.height = fresh.height;
+		maze.grid = fresh.grid;
+	}
+	else
+	{
+		for (int y = 0; y < fresh.grid.height; y++)
+		{
+			// read through const, the non-const row is for writing (and would copy a mapped grid)
+			const uint64_t* oldRow = static_cast<const Grid&>(maze.grid).row(y);
+			const uint64_t* newRow = static_cast<const Grid&>(fresh.grid).row(y);
+			for (int w = 0; w < fresh.grid.wordsPerRow; w++)
+			{
+				uint64_t changed = oldRow[w] ^ newRow[w];
+				while (changed)
+				{
+					int x = w * 64 + lowestBit(changed);
+					changed &= changed - 1;
+					if (fresh.grid.isWall(x, y))
+						diff.addedWalls.push_back(make_pair(x, y));
+					else
+						diff.removedWalls.push_back(make_pair(x, y));
+				}
+			}
+		}
+		for (size_t i = 0; i < diff.addedWalls.size(); i++)
+			maze.grid.setWall(diff.addedWalls[i].first, diff.addedWalls[i].second, true);
+		for (size_t i = 0; i < diff.removedWalls.size(); i++)
+			maze.grid.setWall(diff.removedWalls[i].first, diff.removedWalls[i].second, false);
+		maze.grid.entities.swap(fresh.grid.entities); // only a handful of cells
+	}
+
+	// carry the state of pairs that are still there over to the new door list
+	Player& player = maze.player;
+	Player& next = fresh.player;
+	for (size_t i = 0; i < next.doors.size(); i++)
+	{
+		unordered_map<int, int>::iterator it = player.doorByTag.find(next.doors[i].id);
+		if (it == player.doorByTag.end())
+		{
+			diff.doorsAdded++;
+			continue;
+		}
+		Door& old = player.doors[it->second];
+		Door& door = next.doors[i];
+		if (old.doorx != door.doorx || old.doory != door.doory || old.keyhomex != door.keyhomex || old.keyhomey != door.keyhomey)
+			diff.doorsMoved++;
+		door.open = old.open;
+		door.have_key = old.have_key;
+		door.r = old.r;
+		door.g = old.g;
+		door.b = old.b;
+		if (old.have_key) // still in our hands
+		{
+			door.keyx = old.keyx;
+			door.keyy = old.keyy;
+			door.keyz = old.keyz;
+			next.carried.push_back((int)i);
+		}
+	}
+	diff.doorsRemoved = (int)player.doors.size() - ((int)next.doors.size() - diff.doorsAdded);
+	player.doors.swap(next.doors);
+	player.doorByTag.swap(next.doorByTag);
+	player.carried.swap(next.carried);
+	player.startx = next.startx;
+	player.starty = next.starty;
+	player.goalx = next.goalx;
+	player.goaly = next.goaly;
+	return true;
+}
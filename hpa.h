@@ -0,0 +1,485 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+#include <utility>
+#include "parse.h"
+#include "parallel.h"
+// hierarchical path finding (HPA*) for maps too big to search cell by cell: the map is
+// cut into 64x64 clusters, the open cell pairs across each cluster border are grouped
+// into runs and every run gets a way through (its middle, or both ends of a long one).
+// each way through is a node on both sides, and inside a cluster every node knows how
+// far every other one is (a BFS per node, all clusters on all cores).
+// a query adds the start and the goal to their clusters, runs A* over the nodes only and
+// then fills in the cells between them with a BFS kept inside one cluster at a time.
+// paths are 4-way like solver.h and the flow field, and near shortest (exact inside a
+// cluster, only the crossings between clusters are fixed).
+// closed doors are walls. every query first compares the doors with the ones the graph
+// was made with, and remakes only the clusters around a door that opened or shut (the
+// door's cluster, and the one across a border it sits on).
+// walls that change (a hot reload, see reloadMap) go to wallsChanged, which does the same
+// for every changed cell. walls changed behind its back are caught by Grid::wallVersion
+// and the whole graph is made again.
+// not thread safe, one query at a time.
+const int HPA_CLUSTER = 64;
+const uint16_t HPA_NONE = 0xffff;
+const int hpaStepX[4] = { 0, 0, -1, 1 }; // up, down, left, right
+const int hpaStepY[4] = { 1, -1, 0, 0 };
+
+class ClusterGraph {
+public:
+	int width = 0;
+	int height = 0;
+	int clustersX = 0;
+	int clustersY = 0;
+	size_t expanded = 0; // nodes taken off the open list by the last query
+	int cost = 0;        // steps of the last path
+	int rebuilt = 0;     // clusters remade by the last refresh or wallsChanged
+
+	// make the whole graph, clusters spread over threads (0 = all cores)
+	void build(const MazeInstance& maze, int threads = 0)
+	{
+		const Grid& g = maze.grid;
+		grid = &g;
+		walls = g.wallVersion();
+		this->threads = threads;
+		width = g.width;
+		height = g.height;
+		clustersX = (width + HPA_CLUSTER - 1) / HPA_CLUSTER;
+		clustersY = (height + HPA_CLUSTER - 1) / HPA_CLUSTER;
+		int count = clustersX * clustersY;
+		closedDoors.assign(((size_t)width * height + 63) / 64, 0);
+		doorCell.assign(maze.player.doors.size(), -1);
+		for (size_t i = 0; i < maze.player.doors.size(); i++)
+		{
+			doorCell[i] = closedCell(maze, maze.player.doors[i]);
+			if (doorCell[i] >= 0)
+				setDoor((int)(doorCell[i] % width), (int)(doorCell[i] / width), true);
+		}
+		clusters.assign(count, Cluster());
+		east.assign(count, std::vector<uint16_t>());
+		north.assign(count, std::vector<uint16_t>());
+		for (int c = 0; c < count; c++)
+		{
+			Cluster& k = clusters[c];
+			k.x0 = (c % clustersX) * HPA_CLUSTER;
+			k.y0 = (c / clustersX) * HPA_CLUSTER;
+			k.x1 = std::min(k.x0 + HPA_CLUSTER, width);
+			k.y1 = std::min(k.y0 + HPA_CLUSTER, height);
+		}
+		parallelFor(count, [&](int c) { findBorders(c, true, true); }, workers());
+		parallelFor(count, [&](int c) { buildCluster(c); }, workers());
+		rebuilt = count;
+	}
+	// bring the graph up to date with the doors, returns how many clusters were remade
+	int refresh(const MazeInstance& maze)
+	{
+		grid = &maze.grid;
+		if (maze.grid.width != width || maze.grid.height != height || maze.player.doors.size() != doorCell.size() ||
+			maze.grid.wallVersion() != walls)
+		{
+			build(maze, threads);
+			return rebuilt;
+		}
+		Changes changes;
+		for (size_t i = 0; i < maze.player.doors.size(); i++)
+		{
+			// opened, shut, or moved by a reload
+			int64_t cell = closedCell(maze, maze.player.doors[i]);
+			if (cell == doorCell[i])
+				continue;
+			int64_t ends[2] = { doorCell[i], cell };
+			for (int e = 0; e < 2; e++)
+			{
+				if (ends[e] < 0)
+					continue;
+				setDoor((int)(ends[e] % width), (int)(ends[e] / width), e == 1);
+				cellChanged((int)(ends[e] % width), (int)(ends[e] / width), changes);
+			}
+			doorCell[i] = cell;
+		}
+		return remake(changes);
+	}
+	// the walls on these cells were put up or taken down (MapDiff::addedWalls and
+	// removedWalls after a reload): remake only the clusters around them
+	int wallsChanged(const MazeInstance& maze, const std::vector<std::pair<int, int> >& cells)
+	{
+		grid = &maze.grid;
+		if (maze.grid.width != width || maze.grid.height != height)
+		{
+			build(maze, threads);
+			return rebuilt;
+		}
+		Changes changes;
+		for (size_t i = 0; i < cells.size(); i++)
+			if (maze.grid.inside(cells[i].first, cells[i].second))
+				cellChanged(cells[i].first, cells[i].second, changes);
+		walls = maze.grid.wallVersion();
+		return remake(changes);
+	}
+	size_t nodeCount() const
+	{
+		size_t total = 0;
+		for (size_t c = 0; c < clusters.size(); c++)
+			total += clusters[c].nodeX.size();
+		return total;
+	}
+	// path from (sx, sy) to (gx, gy), every cell, both ends included. false if there is
+	// no way. build() first, doors are picked up by the refresh every query starts with
+	bool findPath(const MazeInstance& maze, int sx, int sy, int gx, int gy, std::vector<std::pair<int, int> >& path)
+	{
+		path.clear();
+		expanded = 0;
+		cost = 0;
+		refresh(maze);
+		if (!walkable(sx, sy) || !walkable(gx, gy))
+			return false;
+		int cs = clusterOf(sx, sy), cg = clusterOf(gx, gy);
+		const Cluster& start = clusters[cs];
+		const Cluster& goal = clusters[cg];
+		// how far the start is from the nodes of its cluster, and the goal from the nodes of its
+		std::vector<char> cells;
+		std::vector<uint16_t> near, far, scratch;
+		clusterCells(start, cells);
+		clusterBfs(start, cells, sx, sy, near, scratch);
+		int direct = cs == cg ? near[local(start, gx, gy)] : HPA_NONE;
+		std::vector<uint16_t> fromStart(start.nodeX.size()), toGoal(goal.nodeX.size());
+		for (size_t i = 0; i < start.nodeX.size(); i++)
+			fromStart[i] = near[local(start, start.nodeX[i], start.nodeY[i])];
+		clusterCells(goal, cells);
+		clusterBfs(goal, cells, gx, gy, far, scratch);
+		for (size_t i = 0; i < goal.nodeX.size(); i++)
+			toGoal[i] = far[local(goal, goal.nodeX[i], goal.nodeY[i])];
+
+		// A* over the nodes, a node is cluster << 16 | its index there
+		const uint64_t START = ~(uint64_t)0, GOAL = ~(uint64_t)0 - 1;
+		struct Visit { int g; uint64_t parent; bool closed; };
+		std::unordered_map<uint64_t, Visit> visits;
+		typedef std::pair<int, uint64_t> OpenNode;
+		std::priority_queue<OpenNode, std::vector<OpenNode>, std::greater<OpenNode> > open;
+		auto relax = [&](uint64_t node, int g, uint64_t parent, int x, int y) {
+			std::unordered_map<uint64_t, Visit>::iterator it = visits.find(node);
+			if (it != visits.end() && (it->second.closed || it->second.g <= g))
+				return;
+			Visit visit = { g, parent, false };
+			visits[node] = visit;
+			open.push(OpenNode(g + abs(gx - x) + abs(gy - y), node));
+		};
+		for (size_t i = 0; i < start.nodeX.size(); i++)
+			if (fromStart[i] != HPA_NONE)
+				relax((uint64_t)cs << 16 | i, fromStart[i], START, start.nodeX[i], start.nodeY[i]);
+		if (direct != HPA_NONE)
+			relax(GOAL, direct, START, gx, gy);
+		bool found = false;
+		while (!open.empty())
+		{
+			uint64_t node = open.top().second;
+			open.pop();
+			Visit& visit = visits[node];
+			if (visit.closed)
+				continue;
+			visit.closed = true;
+			expanded++;
+			if (node == GOAL)
+			{
+				found = true;
+				break;
+			}
+			int c = (int)(node >> 16), i = (int)(node & 0xffff), g = visit.g;
+			const Cluster& k = clusters[c];
+			int n = (int)k.nodeX.size();
+			if (c == cg && toGoal[i] != HPA_NONE)
+				relax(GOAL, g + toGoal[i], node, gx, gy);
+			for (int j = 0; j < n; j++)
+			{
+				uint16_t d = k.dist[(size_t)i * n + j];
+				if (j != i && d != HPA_NONE)
+					relax((uint64_t)c << 16 | j, g + d, node, k.nodeX[j], k.nodeY[j]);
+			}
+			int lc, li;
+			link(c, i, lc, li);
+			relax((uint64_t)lc << 16 | li, g + 1, node, clusters[lc].nodeX[li], clusters[lc].nodeY[li]);
+		}
+		if (!found)
+			return false;
+
+		// the nodes from the start to the goal, then the cells between each pair of them
+		std::vector<uint64_t> chain;
+		for (uint64_t node = GOAL; node != START; node = visits[node].parent)
+			chain.push_back(node);
+		std::reverse(chain.begin(), chain.end());
+		int x = sx, y = sy, c = cs;
+		path.push_back(std::make_pair(sx, sy));
+		for (size_t s = 0; s < chain.size(); s++)
+		{
+			int nx = gx, ny = gy, nc = cg;
+			if (chain[s] != GOAL)
+			{
+				nc = (int)(chain[s] >> 16);
+				nx = clusters[nc].nodeX[chain[s] & 0xffff];
+				ny = clusters[nc].nodeY[chain[s] & 0xffff];
+			}
+			if (nc != c) // a step across the border
+				path.push_back(std::make_pair(nx, ny));
+			else
+				clusterPath(clusters[c], x, y, nx, ny, path, cells, near, scratch);
+			x = nx;
+			y = ny;
+			c = nc;
+		}
+		cost = (int)path.size() - 1;
+		return true;
+	}
+private:
+	class Cluster {
+	public:
+		int x0, y0, x1, y1; // cells x0..x1-1, y0..y1-1
+		int offset[5];      // where the nodes on the west, east, south and north border start
+		std::vector<int> nodeX;
+		std::vector<int> nodeY;
+		std::vector<uint16_t> dist; // nodes x nodes, HPA_NONE when there is no way inside
+	};
+	const Grid* grid = NULL;
+	int threads = 0;
+	std::vector<Cluster> clusters;
+	// ways through the east and north border of each cluster, by how far along it they are
+	std::vector<std::vector<uint16_t> > east;
+	std::vector<std::vector<uint16_t> > north;
+	std::vector<uint64_t> closedDoors; // one bit a cell
+	std::vector<int64_t> doorCell;     // the cell each door shut off when the graph was last brought up to date, -1 if none
+	uint64_t walls = 0;                // Grid::wallVersion the graph was made with
+	// clusters to remake, and the east and north borders (by cluster) to look at again
+	class Changes {
+	public:
+		std::vector<int> clusters;
+		std::vector<int> east;
+		std::vector<int> north;
+	};
+
+	// (x, y) opened or closed: its own cluster, and the borders it is on with the clusters across them
+	void cellChanged(int x, int y, Changes& changes) const
+	{
+		int cx = x / HPA_CLUSTER, cy = y / HPA_CLUSTER, c = cy * clustersX + cx;
+		const Cluster& k = clusters[c];
+		changes.clusters.push_back(c);
+		if (x == k.x0 && cx > 0)
+		{
+			changes.east.push_back(c - 1);
+			changes.clusters.push_back(c - 1);
+		}
+		if (x == k.x1 - 1 && cx + 1 < clustersX)
+		{
+			changes.east.push_back(c);
+			changes.clusters.push_back(c + 1);
+		}
+		if (y == k.y0 && cy > 0)
+		{
+			changes.north.push_back(c - clustersX);
+			changes.clusters.push_back(c - clustersX);
+		}
+		if (y == k.y1 - 1 && cy + 1 < clustersY)
+		{
+			changes.north.push_back(c);
+			changes.clusters.push_back(c + clustersX);
+		}
+	}
+	int remake(Changes& changes)
+	{
+		std::vector<int>* lists[3] = { &changes.clusters, &changes.east, &changes.north };
+		for (int i = 0; i < 3; i++)
+		{
+			std::sort(lists[i]->begin(), lists[i]->end());
+			lists[i]->erase(std::unique(lists[i]->begin(), lists[i]->end()), lists[i]->end());
+		}
+		for (size_t i = 0; i < changes.east.size(); i++)
+			findBorders(changes.east[i], true, false);
+		for (size_t i = 0; i < changes.north.size(); i++)
+			findBorders(changes.north[i], false, true);
+		parallelFor((int)changes.clusters.size(), [&](int i) { buildCluster(changes.clusters[i]); }, workers());
+		rebuilt = (int)changes.clusters.size();
+		return rebuilt;
+	}
+	// a paged grid reads its walls through the tile cache, which isn't thread safe
+	int workers() const
+	{
+		return grid->tiles ? 1 : threads;
+	}
+	int64_t closedCell(const MazeInstance& maze, const Door& door) const
+	{
+		if (door.door == 0 || door.open || !maze.grid.inside(door.doorx, door.doory))
+			return -1;
+		return (int64_t)door.doory * width + door.doorx;
+	}
+	void setDoor(int x, int y, bool closed)
+	{
+		size_t c = (size_t)y * width + x;
+		if (closed)
+			closedDoors[c >> 6] |= (uint64_t)1 << (c & 63);
+		else
+			closedDoors[c >> 6] &= ~((uint64_t)1 << (c & 63));
+	}
+	bool walkable(int x, int y) const
+	{
+		if (x < 0 || y < 0 || x >= width || y >= height)
+			return false;
+		size_t c = (size_t)y * width + x;
+		if ((closedDoors[c >> 6] >> (c & 63)) & 1)
+			return false;
+		return grid->wordsPerRow > 0 ? !((grid->row(y)[x >> 6] >> (x & 63)) & 1) : !grid->isWall(x, y);
+	}
+	int clusterOf(int x, int y) const
+	{
+		return (y / HPA_CLUSTER) * clustersX + x / HPA_CLUSTER;
+	}
+	// local cells have a ring of closed ones around the cluster, so the BFS needs no edge checks
+	static int local(const Cluster& k, int x, int y)
+	{
+		return (y - k.y0 + 1) * (k.x1 - k.x0 + 2) + (x - k.x0 + 1);
+	}
+	// the ways through the east and/or north border of cluster c
+	void findBorders(int c, bool doEast, bool doNorth)
+	{
+		const Cluster& k = clusters[c];
+		int cx = c % clustersX, cy = c / clustersX;
+		auto runs = [&](int length, std::vector<uint16_t>& out, bool vertical) {
+			out.clear();
+			int runStart = -1;
+			for (int t = 0; t <= length; t++)
+			{
+				bool open = false;
+				if (t < length)
+					open = vertical ? walkable(k.x1 - 1, k.y0 + t) && walkable(k.x1, k.y0 + t)
+						: walkable(k.x0 + t, k.y1 - 1) && walkable(k.x0 + t, k.y1);
+				if (open && runStart < 0)
+					runStart = t;
+				else if (!open && runStart >= 0)
+				{
+					int runEnd = t - 1;
+					if (runEnd - runStart < 5)
+						out.push_back((uint16_t)((runStart + runEnd) / 2));
+					else
+					{
+						out.push_back((uint16_t)runStart);
+						out.push_back((uint16_t)runEnd);
+					}
+					runStart = -1;
+				}
+			}
+		};
+		if (doEast && cx + 1 < clustersX)
+			runs(k.y1 - k.y0, east[c], true);
+		if (doNorth && cy + 1 < clustersY)
+			runs(k.x1 - k.x0, north[c], false);
+	}
+	// node i of cluster c is a way through a border, (lc, li) is the same way on the other side
+	void link(int c, int i, int& lc, int& li) const
+	{
+		const Cluster& k = clusters[c];
+		int side = 0;
+		while (i >= k.offset[side + 1])
+			side++;
+		int t = i - k.offset[side];
+		switch (side)
+		{
+		case 0: lc = c - 1; li = clusters[lc].offset[1] + t; break;
+		case 1: lc = c + 1; li = clusters[lc].offset[0] + t; break;
+		case 2: lc = c - clustersX; li = clusters[lc].offset[3] + t; break;
+		default: lc = c + clustersX; li = clusters[lc].offset[2] + t; break;
+		}
+	}
+	// the nodes of cluster c from its four borders and how far apart they are inside it
+	void buildCluster(int c)
+	{
+		Cluster& k = clusters[c];
+		int cx = c % clustersX, cy = c / clustersX;
+		k.nodeX.clear();
+		k.nodeY.clear();
+		const std::vector<uint16_t> none;
+		const std::vector<uint16_t>* sides[4] = {
+			cx > 0 ? &east[c - 1] : &none, &east[c], cy > 0 ? &north[c - clustersX] : &none, &north[c] };
+		for (int side = 0; side < 4; side++)
+		{
+			k.offset[side] = (int)k.nodeX.size();
+			for (size_t t = 0; t < sides[side]->size(); t++)
+			{
+				int along = (*sides[side])[t];
+				k.nodeX.push_back(side == 0 ? k.x0 : side == 1 ? k.x1 - 1 : k.x0 + along);
+				k.nodeY.push_back(side == 2 ? k.y0 : side == 3 ? k.y1 - 1 : k.y0 + along);
+			}
+		}
+		int n = (int)k.nodeX.size();
+		k.offset[4] = n;
+		k.dist.assign((size_t)n * n, HPA_NONE);
+		std::vector<char> cells;
+		std::vector<uint16_t> distance, queue;
+		clusterCells(k, cells);
+		for (int i = 0; i < n; i++)
+		{
+			clusterBfs(k, cells, k.nodeX[i], k.nodeY[i], distance, queue);
+			for (int j = 0; j < n; j++)
+				k.dist[(size_t)i * n + j] = distance[local(k, k.nodeX[j], k.nodeY[j])];
+		}
+	}
+	// which cells of cluster k are open, by local cell. the BFS below run over this copy
+	// instead of the grid, a cluster is searched once per node while it is being made
+	void clusterCells(const Cluster& k, std::vector<char>& cells) const
+	{
+		int w = k.x1 - k.x0 + 2, h = k.y1 - k.y0 + 2;
+		cells.assign((size_t)w * h, 0);
+		for (int y = k.y0; y < k.y1; y++)
+			for (int x = k.x0; x < k.x1; x++)
+				cells[local(k, x, y)] = walkable(x, y);
+	}
+	// BFS from (x, y) without leaving cluster k, distance by local cell
+	void clusterBfs(const Cluster& k, const std::vector<char>& cells, int x, int y, std::vector<uint16_t>& distance, std::vector<uint16_t>& queue) const
+	{
+		int w = k.x1 - k.x0 + 2;
+		const int steps[4] = { w, -w, -1, 1 };
+		distance.assign(cells.size(), HPA_NONE);
+		queue.clear();
+		int first = local(k, x, y);
+		distance[first] = 0;
+		queue.push_back((uint16_t)first);
+		for (size_t q = 0; q < queue.size(); q++)
+		{
+			int l = queue[q];
+			for (int d = 0; d < 4; d++)
+			{
+				int nl = l + steps[d];
+				if (distance[nl] != HPA_NONE || !cells[nl])
+					continue;
+				distance[nl] = (uint16_t)(distance[l] + 1);
+				queue.push_back((uint16_t)nl);
+			}
+		}
+	}
+	// the cells after (ax, ay) up to (bx, by), staying inside cluster k: a BFS from b,
+	// then downhill from a
+	void clusterPath(const Cluster& k, int ax, int ay, int bx, int by, std::vector<std::pair<int, int> >& path,
+		std::vector<char>& cells, std::vector<uint16_t>& distance, std::vector<uint16_t>& queue) const
+	{
+		if (ax == bx && ay == by) // the same cell on two borders
+			return;
+		clusterCells(k, cells);
+		clusterBfs(k, cells, bx, by, distance, queue);
+		int x = ax, y = ay;
+		while (x != bx || y != by)
+		{
+			uint16_t here = distance[local(k, x, y)];
+			for (int d = 0; d < 4; d++)
+			{
+				int nx = x + hpaStepX[d], ny = y + hpaStepY[d];
+				if (distance[local(k, nx, ny)] + 1 == here) // never true on the closed ring
+				{
+					x = nx;
+					y = ny;
+					break;
+				}
+			}
+			path.push_back(std::make_pair(x, y));
+		}
+	}
+};
@@ -1,1630 +1,188 @@
+// Maze generator: carves a random maze and writes it as a map file the game reads
+// (parseMapFile), walls 'W', start 'S', goal 'G'.
+// -n makes a batch of mazes on all cores, maze i gets random stream i of the seed so
+// a batch comes out the same whatever -j is. mappack can bundle them into a pack.
+// -e streams an Eller's algorithm maze row by row instead (eller.h), in O(width)
+// memory, for mazes that are far longer than they are wide. it has no keys.
+// -c writes a block of chunks of the endless chunked maze (chunk.h) as one map.
+// -a picks the carving algorithm (engines.h): flood (the default), backtracker,
+// wilson, kruskal, binarytree, sidewinder or parallel. parallel carves one big maze on
+// all cores (-j threads), -l adds that share of extra openings between its regions.
+//
+//Linux build: g++ -O2 map.cpp -o map -pthread
+//usage:       ./map [-d] [-a engine] [-j threads] [-l loops] [-o map.txt] width height [keys] [seed]
+//             ./map -n count [-j threads] [-a engine] [-o prefix] width height [keys] [seed]
+//             ./map -e [-o map.txt] width height [seed]
+//             ./map -c [-o map.txt] chunks_x chunks_y [seed]
+//             without -o the map goes to stdout, a batch to maze00000.txt ...
+//             -d dumps the maze to stderr after every carving step (small mazes only).
+
 #include <cstdio>
-#include <iostream>
-#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <chrono>
 #include <string>
-#include <vector>
+#include <atomic>
+#include "generate.h"
+#include "engines.h"
+#include "eller.h"
+#include "chunk.h"
+#include "parallel.h"
 using namespace std;
-float way3_2 = 0.5;
-float way3_1 = 0.6;
-float way3_0 = 0.33;
-
-float way2_1 = 0.5;
-float way2_0 = 0.5;
 
-float way1_0 = 0.75;
-float half = 0.5;
-int width;
-int height;
-float rand01() {
-	return rand() / (float)RAND_MAX;
-}
-class block
+int main(int argc, char* argv[])
 {
-public:
-	int x;
-	int y;
-	string type;
-	block(int x, int y, string type)
+	const char* output = NULL;
+	int count = 0; // 0 = one maze, not a batch
+	bool eller = false;
+	bool chunks = false;
+	int threads = 0;
+	const char* engineName = "flood";
+	vector<const char*> args;
+	for (int i = 1; i < argc; i++)
 	{
-		this->x = x;
-		this->y = y;
-		this->type = type;
+		if (strcmp(argv[i], "-d") == 0)
+			debug_steps = true;
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			output = argv[++i];
+		else if (strcmp(argv[i], "-e") == 0)
+			eller = true;
+		else if (strcmp(argv[i], "-c") == 0)
+			chunks = true;
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			count = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc)
+			engineName = argv[++i];
+		else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+			region_loops = (float)atof(argv[++i]);
+		else
+			args.push_back(argv[i]);
 	}
-};
-std::vector<block> blocks;
-std::vector<block> allzeors;
-bool spawn_walls(int x, int y)
-{
-	for (int i = 0; i < allzeors.size(); i++)
+	if (args.size() < 2 || args.size() > 4 || atoi(args[0]) < 1 || atoi(args[1]) < 1)
 	{
-		if (allzeors[i].x == x && allzeors[i].y == y)
-		{
-			return false;
-		}
+		printf("usage: %s [-d] [-a engine] [-j threads] [-l loops] [-o map.txt] width height [keys] [seed]\n", argv[0]);
+		printf("       %s -n count [-j threads] [-a engine] [-o prefix] width height [keys] [seed]\n", argv[0]);
+		printf("       %s -e [-o map.txt] width height [seed]\n", argv[0]);
+		printf("       %s -c [-o map.txt] chunks_x chunks_y [seed]\n", argv[0]);
+		return 1;
 	}
-	return true;
-}
-void spawn_keys(int x, int y)
-{
-
-}
-void generate_map(int width, int height, int keys)
-{
-	
-	char map[width][height];
-	for (int i = 0; i < width; i++)
+	int w = atoi(args[0]);
+	int h = atoi(args[1]);
+	int keys = args.size() > 2 ? atoi(args[2]) : 0;
+	uint64_t seed = args.size() > 3 ? strtoull(args[3], NULL, 10) : (uint64_t)time(NULL);
+	const maze_engine* engine = find_engine(engineName);
+	if (engine == NULL)
 	{
-		for (int j = 0; j < height; j++)
-		{
-			map[i][j] = '0';
-			
-		}
+		printf("no engine called '%s', there are:", engineName);
+		int engineCount;
+		const maze_engine* const* all = maze_engines(engineCount);
+		for (int i = 0; i < engineCount; i++)
+			printf(" %s", all[i]->name());
+		printf("\n");
+		return 1;
 	}
-	int startx = rand() % width;
-	int starty = rand() % height;
-	cout << startx << " " << starty << endl;
-	map[startx][starty] = 'S';
-	block init1(startx, starty+1, "up");
-	block init2(startx, starty-1, "down");
-	block init3(startx-1, starty, "left");
-	block init4(startx+1, starty, "right");
 
-	blocks.push_back(init1);
-	blocks.push_back(init2);
-	blocks.push_back(init3);
-	blocks.push_back(init4);
-	block init(startx, starty, "center");
-	allzeors.push_back(init);
-	allzeors.push_back(init1);
-	allzeors.push_back(init2);
-	allzeors.push_back(init3);
-	allzeors.push_back(init4);
-
-	while (blocks.size() > 1)
+	if ((eller || chunks) && args.size() == 3) // no keys, the third one is the seed
 	{
-		//cout << blocks.size();
-		if (map[blocks[0].x][blocks[0].y] == 'W'|| map[blocks[0].x][blocks[0].y] == 'S') // this was cause by first way's sub way piror than second way, so that sub way occupy second way as wall 
-		{
-			
-			blocks.erase(blocks.begin()); // erase first element
-			continue;
-		}
-
-		int x = blocks[0].x;
-		int y = blocks[0].y;
-		if (blocks[0].type == "up")
+		seed = strtoull(args[2], NULL, 10);
+	}
+	if (chunks)
+	{
+		// chunks (0, 0) to (w - 1, h - 1), start in the first one and goal in the last
+		chunk_world world(seed);
+		world.hasGoal = true;
+		world.goalChunkX = w - 1;
+		world.goalChunkY = h - 1;
+		map_buffer map;
+		if (!map.create(w * CHUNK_SIZE, h * CHUNK_SIZE, output))
 		{
-			//cout << blocks.size();
-			int x1 = blocks[0].x;
-			int y1 = blocks[0].y+1;
-			bool block1 = false;
-
-			int x2 = blocks[0].x - 1;
-			int y2 = blocks[0].y;
-			bool block2 = false;
-
-			int x3 = blocks[0].x + 1;
-			int y3 = blocks[0].y;
-			bool block3 = false;
-
-			int ava_block = 0;
-			if (x1 >= 0 && x1 < width && y1 >= 0 && y1 < height &&map[x1][y1]=='0')
-			{
-				block1 = true;
-				ava_block++;
-			}
-			if (x2 >= 0 && x2 < width && y2 >= 0 && y2 < height && map[x2][y2] =='0')
-			{
-				block2 = true;
-				ava_block++;
-			}
-			if (x3 >= 0 && x3 < width && y3 >= 0 && y3 < height && map[x3][y3] =='0')
-			{
-				block3 = true;
-				ava_block++;
-			}
-			
-			if (ava_block == 0) // no avaliable block
-			{
-				//cout << blocks.size();
-				blocks.erase(blocks.begin()); // erase first element
-				continue;
-			}
-			
-			if (block1) // if the upper block is avaliable
-			{
-				if (ava_block == 1) // only one block avaliable, which one?->block1
-				{
-					if (rand01() <= way1_0) // save it
-					{
-						// block 1 become 0
-						map[x1][y1] = '0';
-						block upper(x1, y1, "up");
-						blocks.push_back(upper);allzeors.push_back(upper);
-					}
-					else // block it
-					{
-						if (spawn_walls(x1, y1))
-						{
-							map[x1][y1] = 'W';
-						}
-						
-					}
-				}
-				else if (ava_block == 2)
-				{
-					if (block2) // 1,2 ava
-					{
-						if (rand01() <= way2_1) // +1 both 1 and 2 ava
-						{
-							block upper(x1, y1, "up");
-							blocks.push_back(upper);allzeors.push_back(upper);
-							block left(x2, y2, "left");
-							blocks.push_back(left);allzeors.push_back(left);
-							// 1,2 become 0
-						}
-						else 
-						{
-							if (rand01() <= way2_0) // 0: one of 1 and 2 ava
-							{
-								if (rand01() >= 0.5)
-								{
-									block upper(x1, y1, "up");
-									blocks.push_back(upper);allzeors.push_back(upper);
-									if (spawn_walls(x2, y2))
-									{
-										map[x2][y2] = 'W';
-									}
-									// 1 become 0, 2 become W
-								}
-								else
-								{
-									block left(x2, y2, "left");
-									blocks.push_back(left);allzeors.push_back(left);
-										if (spawn_walls(x1, y1))
-										{
-											map[x1][y1] = 'W';
-										}
-									// 2 become 0, 1 become W
-								}
-							}
-							else // -1 both 1 and 2 block
-							{
-								if (spawn_walls(x1, y1))
-								{
-									map[x1][y1] = 'W';
-								}
-								if (spawn_walls(x2, y2))
-								{
-									map[x2][y2] = 'W';
-								}
-							}
-						}
-					}
-					else // 1,3 ava
-					{
-						if (rand01() >= 0.5) // +1 both 1 and 3 ava
-						{
-							block upper(x1, y1, "up");
-							blocks.push_back(upper);allzeors.push_back(upper);
-							block right(x3, y3, "right");
-							blocks.push_back(right);allzeors.push_back(right);
-							// 1,3 become 0
-						}
-						else
-						{
-							if (rand01() >= 0.5) // 0: one of 1 and 3 ava
-							{
-								if (rand01() >= 0.5)
-								{
-									block upper(x1, y1, "up");
-									blocks.push_back(upper);allzeors.push_back(upper);
-									if (spawn_walls(x3, y3))
-									{
-										map[x3][y3] = 'W';
-									}
-									
-									// 1 become 0, 3 become W
-								}
-								else
-								{
-									block right(x3, y3, "right");
-									blocks.push_back(right);allzeors.push_back(right);
-									if (spawn_walls(x1, y1))
-									{
-										map[x1][y1] = 'W';
-									}
-									
-									// 3 become 0, 1 become W
-								}
-							}
-							else // -1 both 1 and 2 block
-							{
-								if (spawn_walls(x1, y1))
-								{
-									map[x1][y1] = 'W';
-								}
-								if (spawn_walls(x2, y2))
-								{
-									map[x2][y2] = 'W';
-								}
-								
-							}
-						}
-					}
-				}
-				else if (ava_block == 3)
-				{
-					if (rand01() <= way3_2) // +2 block 0 way
-					{
-						block upper(x1, y1, "up");
-						blocks.push_back(upper);allzeors.push_back(upper);
-						block left(x2, y2, "left");
-						blocks.push_back(left);allzeors.push_back(left);
-						block right(x3, y3, "right");
-						blocks.push_back(right);allzeors.push_back(right);
-						// 1,2,3 become 0
-					}
-					else if(rand01()<=way3_1) // +1 random block one way
-					{
-						if (rand01() <= 0.33) // block 1
-						{
-							block left(x2, y2, "left");
-							blocks.push_back(left);allzeors.push_back(left);
-							block right(x3, y3, "right");
-							blocks.push_back(right);allzeors.push_back(right);
-							if (spawn_walls(x1, y1))
-							{
-								map[x1][y1] = 'W';
-							}
-							
-							// 2,3 become 0
-						}
-						else if (rand01() <= 0.5) // block 2
-						{
-							block upper(x1, y1, "up");
-							blocks.push_back(upper);allzeors.push_back(upper);
-							block right(x3, y3, "right");
-							blocks.push_back(right);allzeors.push_back(right);
-							if (spawn_walls(x2, y2))
-							{
-								map[x2][y2] = 'W';
-							}
-			
-							// 1,3 become 0
-						}
-						else // block 3
-						{
-							block upper(x1, y1, "up");
-							blocks.push_back(upper);allzeors.push_back(upper);
-							block left(x2, y2, "left");
-							blocks.push_back(left);allzeors.push_back(left);
-							
-							if (spawn_walls(x3, y3))
-							{
-								map[x3][y3] = 'W';
-							}
-							// 1,2 become 0
-						}
-					}
-					else if(rand01()<=way3_0) // -1  block all ways
-					{
-						if (spawn_walls(x1, y1))
-						{
-							map[x1][y1] = 'W';
-						}
-						if (spawn_walls(x2, y2))
-						{
-							map[x2][y2] = 'W';
-						}
-						if (spawn_walls(x3, y3))
-						{
-							map[x3][y3] = 'W';
-						}
-					}
-					else // 0  block two ways
-					{
-						if (rand01() <= 0.33) // leave 1
-						{
-							block upper(x1, y1, "up");
-							blocks.push_back(upper);allzeors.push_back(upper);
-								
-							if (spawn_walls(x2, y2))
-							{
-								map[x2][y2] = 'W';
-							}
-							if (spawn_walls(x3, y3))
-							{
-								map[x3][y3] = 'W';
-							}
-							// 1 become 0
-						}
-						else if (rand01() <= 0.5) // leave 2
-						{
-							block left(x2, y2, "left");
-							blocks.push_back(left);allzeors.push_back(left);
-								if (spawn_walls(x1, y1))
-								{
-									map[x1][y1] = 'W';
-								}
-							
-							if (spawn_walls(x3, y3))
-							{
-								map[x3][y3] = 'W';
-							}
-							// 2 become 0
-						}
-						else // leave 3
-						{
-							block right(x3, y3, "right");
-							blocks.push_back(right);allzeors.push_back(right);
-								if (spawn_walls(x1, y1))
-								{
-									map[x1][y1] = 'W';
-								}
-							if (spawn_walls(x2, y2))
-							{
-								map[x2][y2] = 'W';
-							}
-							
-							// 3 become 0
-						}
-					}
-				}
-			}
-			else if (block2) //left block is avaliable, upper block is not avaliable
-			{
-				if (ava_block == 1) // only one block avaliable, block 2 avaliable 
-				{
-					if (rand01() <= way1_0) // save it
-					{
-						// block 2 become 0
-						map[x2][y2] = '0';
-						block left(x2, y2, "left");
-						blocks.push_back(left);allzeors.push_back(left);
-					}
-					else // block it
-					{
-						
-						if (spawn_walls(x2, y2))
-						{
-							map[x2][y2] = 'W';
-						}
-						
-					}
-				}
-				else // two block avaliable, which is 2 and 3
-				{
-					if (rand01() <= way2_1) // +1 both 2 and 3 ava
-					{
-						block right(x3, y3, "right");
-						blocks.push_back(right);allzeors.push_back(right);
-						block left(x2, y2, "left");
-						blocks.push_back(left);allzeors.push_back(left);
-						// 2,3 become 0
-					}
-					else
-					{
-						if (rand01() <= way2_0) // 0: one of 2 and 3 ava
-						{
-							if (rand01() >= 0.5)
-							{
-								block right(x3, y3, "right");
-								blocks.push_back(right);allzeors.push_back(right);
-								
-								if (spawn_walls(x2, y2))
-								{
-									map[x2][y2] = 'W';
-								}
-								
-								// 3 become 0, 2 become W, 1 is not avaliable
-							}
-							else
-							{
-								block left(x2, y2, "left");
-								blocks.push_back(left);allzeors.push_back(left);
-									
-								if (spawn_walls(x3, y3))
-								{
-									map[x3][y3] = 'W';
-								}
-								// 2 become 0, 3 become W, 1 is not avaliable
-							}
-						}
-						else // -1 both 1 and 2 block
-						{
-							if (spawn_walls(x1, y1))
-							{
-								map[x1][y1] = 'W';
-							}
-							if (spawn_walls(x2, y2))
-							{
-								map[x2][y2] = 'W';
-							}
-							
-						}
-					}
-					
-				}
-			}
-			else { // only block 3 is avaliable 
-				if (rand01() <= way1_0) // save it
-				{
-					// block 3 become 0
-					map[x3][y3] = '0';
-					block right(x3, y3, "right");
-					blocks.push_back(right);allzeors.push_back(right);
-				}
-				else // block it
-				{
-					
-					if (spawn_walls(x3, y3))
-					{
-						map[x3][y3] = 'W';
-					}
-				}
-			}
-			blocks.erase(blocks.begin()); // erase first element
+			printf("Can't make a %d x %d map\n", w * CHUNK_SIZE, h * CHUNK_SIZE);
+			return 1;
 		}
-		else if (blocks[0].type == "down")
+		auto begin = chrono::steady_clock::now();
+		parallelFor(w * h, [&](int i) {
+			chunk c;
+			world.generate(i % w, i / w, c);
+			for (int y = 0; y < CHUNK_SIZE; y++)
+				memcpy(&map.at(c.cx * CHUNK_SIZE, c.cy * CHUNK_SIZE + y), c.cells + y * CHUNK_SIZE, CHUNK_SIZE);
+		}, threads);
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+		if (output == NULL)
 		{
-		
-			// block 1 down
-			int x1 = blocks[0].x;
-			int y1 = blocks[0].y - 1;
-			bool block1 = false;
-			// block 2 left
-			int x2 = blocks[0].x - 1;
-			int y2 = blocks[0].y;
-			bool block2 = false;
-			// block 3 right
-			int x3 = blocks[0].x + 1;
-			int y3 = blocks[0].y;
-			bool block3 = false;
-
-			int ava_block = 0;
-			if (x1 >= 0 && x1 < width && y1 >= 0 && y1 < height && map[x1][y1] =='0')
-			{
-				block1 = true;
-				ava_block++;
-			}
-			if (x2 >= 0 && x2 < width && y2 >= 0 && y2 < height && map[x2][y2] =='0')
-			{
-				block2 = true;
-				ava_block++;
-			}
-			if (x3 >= 0 && x3 < width && y3 >= 0 && y3 < height && map[x3][y3] =='0')
-			{
-				block3 = true;
-				ava_block++;
-			}
-
-			if (ava_block == 0) // no avaliable block
-			{
-				blocks.erase(blocks.begin()); // erase first element
-				continue;
-			}
-			if (block1) // if the below block is avaliable
-			{
-				if (ava_block == 1) // only one block avaliable, which one?->block1
-				{
-					if (rand01() <= way1_0) // save it
-					{
-						// block 1 become 0
-						map[x1][y1] = '0';
-						block below(x1, y1, "down");
-						blocks.push_back(below);allzeors.push_back(below);
-					}
-					else // block it
-					{
-						if (spawn_walls(x1, y1))
-						{
-							map[x1][y1] = 'W';
-						}
-						
-					}
-				}
-				else if (ava_block == 2)
-				{
-					if (block2) // 1,2 ava
-					{
-						if (rand01() <= way2_1) // +1 both 1 and 2 ava
-						{
-							block below(x1, y1, "down");
-							blocks.push_back(below);allzeors.push_back(below);
-							block left(x2, y2, "left");
-							blocks.push_back(left);allzeors.push_back(left);
-							// 1,2 become 0
-						}
-						else
-						{
-							if (rand01() <= way2_0) // 0: one of 1 and 2 ava
-							{
-								if (rand01() >= 0.5)
-								{
-									block below(x1, y1, "down");
-									blocks.push_back(below);allzeors.push_back(below);
-									
-									if (spawn_walls(x2, y2))
-									{
-										map[x2][y2] = 'W';
-									}
-									
-									// 1 become 0, 2 become W
-								}
-								else
-								{
-									block left(x2, y2, "left");
-									blocks.push_back(left);allzeors.push_back(left);
-										if (spawn_walls(x1, y1))
-										{
-											map[x1][y1] = 'W';
-										}
-									
-									// 2 become 0, 1 become W
-								}
-							}
-							else // -1 both 1 and 2 block
-							{
-								if (spawn_walls(x1, y1))
-								{
-									map[x1][y1] = 'W';
-								}
-								if (spawn_walls(x2, y2))
-								{
-									map[x2][y2] = 'W';
-								}
-								
-							}
-						}
-					}
-					else // 1,3 ava
-					{
-						if (rand01() <= way2_1) // +1 both 1 and 3 ava
-						{
-							block below(x1, y1, "down");
-							blocks.push_back(below);allzeors.push_back(below);
-							block right(x3, y3, "right");
-							blocks.push_back(right);allzeors.push_back(right);
-							// 1,3 become 0
-						}
-						else
-						{
-							if (rand01() <= way2_0) // 0: one of 1 and 3 ava
-							{
-								if (rand01() >= 0.5)
-								{
-									block below(x1, y1, "down");
-									blocks.push_back(below);allzeors.push_back(below);
-									
-									if (spawn_walls(x3, y3))
-									{
-										map[x3][y3] = 'W';
-									}
-									// 1 become 0, 3 become W
-								}
-								else
-								{
-									block right(x3, y3, "right");
-									blocks.push_back(right);allzeors.push_back(right);
-										if (spawn_walls(x1, y1))
-										{
-											map[x1][y1] = 'W';
-										}
-									
-									// 3 become 0, 1 become W
-								}
-							}
-							else // -1 both 1 and 2 block
-							{
-								if (spawn_walls(x1, y1))
-								{
-									map[x1][y1] = 'W';
-								}
-								if (spawn_walls(x2, y2))
-								{
-									map[x2][y2] = 'W';
-								}
-								
-							}
-						}
-					}
-				}
-				else if (ava_block == 3)
-				{
-					if (rand01() <=way3_2) // +2 block 0 way
-					{
-						block below(x1, y1, "down");
-						blocks.push_back(below);allzeors.push_back(below);
-						block left(x2, y2, "left");
-						blocks.push_back(left);allzeors.push_back(left);
-						block right(x3, y3, "right");
-						blocks.push_back(right);allzeors.push_back(right);
-						// 1,2,3 become 0
-					}
-					else if (rand01() <= way3_1) // +1 random block one way
-					{
-						if (rand01() <= 0.33) // block 1
-						{
-							block left(x2, y2, "left");
-							blocks.push_back(left);allzeors.push_back(left);
-							block right(x3, y3, "right");
-							blocks.push_back(right);allzeors.push_back(right);
-							if (spawn_walls(x1, y1))
-							{
-								map[x1][y1] = 'W';
-							}
-							
-							// 2,3 become 0
-						}
-						else if (rand01() <= 0.5) // block 2
-						{
-							block below(x1, y1, "down");
-							blocks.push_back(below);allzeors.push_back(below);
-							block right(x3, y3, "right");
-							blocks.push_back(right);allzeors.push_back(right);
-							
-							if (spawn_walls(x2, y2))
-							{
-								map[x2][y2] = 'W';
-							}
-							
-							// 1,3 become 0
-						}
-						else // block 3
-						{
-							block below(x1, y1, "down");
-							blocks.push_back(below);allzeors.push_back(below);
-							block left(x2, y2, "left");
-							blocks.push_back(left);allzeors.push_back(left);
-							
-							if (spawn_walls(x3, y3))
-							{
-								map[x3][y3] = 'W';
-							}
-							// 1,2 become 0
-						}
-					}
-					else if (rand01() <= way3_0) // -1  block all ways
-					{
-						if (spawn_walls(x1, y1))
-						{
-							map[x1][y1] = 'W';
-						}
-						if (spawn_walls(x2, y2))
-						{
-							map[x2][y2] = 'W';
-						}
-						if (spawn_walls(x3, y3))
-						{
-							map[x3][y3] = 'W';
-						}
-					}
-					else // 0  block two ways
-					{
-						if (rand01() <= 0.33) // leave 1
-						{
-							block below(x1, y1, "down");
-							blocks.push_back(below);allzeors.push_back(below);
-								
-							if (spawn_walls(x2, y2))
-							{
-								map[x2][y2] = 'W';
-							}
-							if (spawn_walls(x3, y3))
-							{
-								map[x3][y3] = 'W';
-							}
-							// 1 become 0
-						}
-						else if (rand01() <= 0.5) // leave 2
-						{
-							block left(x2, y2, "left");
-							blocks.push_back(left);allzeors.push_back(left);
-								if (spawn_walls(x1, y1))
-								{
-									map[x1][y1] = 'W';
-								}
-							
-							if (spawn_walls(x3, y3))
-							{
-								map[x3][y3] = 'W';
-							}
-							// 2 become 0
-						}
-						else // leave 3
-						{
-							block right(x3, y3, "right");
-							blocks.push_back(right);allzeors.push_back(right);
-								if (spawn_walls(x1, y1))
-								{
-									map[x1][y1] = 'W';
-								}
-							if (spawn_walls(x2, y2))
-							{
-								map[x2][y2] = 'W';
-							}
-							
-							// 3 become 0
-						}
-					}
-				}
-			}
-			else if (block2) //left block is avaliable, below block is not avaliable
-			{
-				if (ava_block == 1) // only one block avaliable, block 2 avaliable 
-				{
-					if (rand01() <= way1_0) // save it
-					{
-						// block 2 become 0
-						map[x2][y2] = '0';
-						block left(x2, y2, "left");
-						blocks.push_back(left);allzeors.push_back(left);
-					}
-					else // block it
-					{
-						
-						if (spawn_walls(x2, y2))
-						{
-							map[x2][y2] = 'W';
-						}
-						
-					}
-				}
-				else // two block avaliable, which is 2 and 3
-				{
-					if (rand01() <= way2_1) // +1 both 2 and 3 ava
-					{
-						block right(x3, y3, "right");
-						blocks.push_back(right);allzeors.push_back(right);
-						block left(x2, y2, "left");
-						blocks.push_back(left);allzeors.push_back(left);
-						// 2,3 become 0
-					}
-					else
-					{
-						if (rand01() <=way2_0) // 0: one of 2 and 3 ava
-						{
-							if (rand01() >= 0.5)
-							{
-								block right(x3, y3, "right");
-								blocks.push_back(right);allzeors.push_back(right);
-								
-								if (spawn_walls(x2, y2))
-								{
-									map[x2][y2] = 'W';
-								}
-								
-								// 3 become 0, 2 become W, 1 is not avaliable
-							}
-							else
-							{
-								block left(x2, y2, "left");
-								blocks.push_back(left);allzeors.push_back(left);
-									
-								if (spawn_walls(x3, y3))
-								{
-									map[x3][y3] = 'W';
-								}
-								// 2 become 0, 3 become W, 1 is not avaliable
-							}
-						}
-						else // -1 both 1 and 2 block
-						{
-							if (spawn_walls(x1, y1))
-							{
-								map[x1][y1] = 'W';
-							}
-							if (spawn_walls(x2, y2))
-							{
-								map[x2][y2] = 'W';
-							}
-							
-						}
-					}
-
-				}
-			}
-			else { // only block 3 is avaliable 
-				if (rand01() <=way1_0) // save it
-				{
-					// block 3 become 0
-					map[x3][y3] = '0';
-					block right(x3, y3, "right");
-					blocks.push_back(right);allzeors.push_back(right);
-				}
-				else // block it
-				{
-					
-					if (spawn_walls(x3, y3))
-					{
-						map[x3][y3] = 'W';
-					}
-				}
-			}
-			blocks.erase(blocks.begin()); // erase first element
-
+			return map.write(stdout) && fflush(stdout) == 0 ? 0 : 1;
 		}
-		else if (blocks[0].type == "left")
+		if (!map.save(output))
 		{
-			// block 2 left
-			int x2 = blocks[0].x-1;
-			int y2 = blocks[0].y;
-			bool block2 = false;
-			// block 3 down
-			int x3 = blocks[0].x;
-			int y3 = blocks[0].y-1;
-			bool block3 = false;
-			// block 1 up
-			int x1 = blocks[0].x;
-			int y1 = blocks[0].y+1;
-			bool block1 = false;
-			int ava_block = 0;
-			if (x1 >= 0 && x1 < width && y1 >= 0 && y1 < height && map[x1][y1] =='0')
-			{
-				block1 = true;
-				ava_block++;
-			}
-			if (x2 >= 0 && x2 < width && y2 >= 0 && y2 < height && map[x2][y2] =='0')
-			{
-				block2 = true;
-				ava_block++;
-			}
-			if (x3 >= 0 && x3 < width && y3 >= 0 && y3 < height && map[x3][y3] =='0')
-			{
-				block3 = true;
-				ava_block++;
-			}
-			if (ava_block == 0) // no avaliable block
-			{
-				blocks.erase(blocks.begin()); // erase first element
-				continue;
-			}
-
-			if (block1) // if the upper block is avaliable
-			{
-				if (ava_block == 1) // only one block avaliable, which one?->block1
-				{
-					if (rand01() <= way1_0) // save it
-					{
-						// block 1 become 0
-						map[x1][y1] = '0';
-						block upper(x1, y1, "up");
-						blocks.push_back(upper);allzeors.push_back(upper);
-					}
-					else // block it
-					{
-						if (spawn_walls(x1, y1))
-						{
-							map[x1][y1] = 'W';
-						}
-						
-					}
-				}
-				else if (ava_block == 2)
-				{
-					if (block2) // 1,2 ava
-					{
-						if (rand01() <= way2_1) // +1 both 1 and 2 ava
-						{
-							block upper(x1, y1, "up");
-							blocks.push_back(upper);allzeors.push_back(upper);
-							block left(x2, y2, "left");
-							blocks.push_back(left);allzeors.push_back(left);
-							// 1,2 become 0
-						}
-						else
-						{
-							if (rand01() <= way2_0) // 0: one of 1 and 2 ava
-							{
-								if (rand01() >= 0.5)
-								{
-									block upper(x1, y1, "up");
-									blocks.push_back(upper);allzeors.push_back(upper);
-									
-									if (spawn_walls(x2, y2))
-									{
-										map[x2][y2] = 'W';
-									}
-									
-									// 1 become 0, 2 become W
-								}
-								else
-								{
-									block left(x2, y2, "left");
-									blocks.push_back(left);allzeors.push_back(left);
-										if (spawn_walls(x1, y1))
-										{
-											map[x1][y1] = 'W';
-										}
-									
-									// 2 become 0, 1 become W
-								}
-							}
-							else // -1 both 1 and 2 block
-							{
-								if (spawn_walls(x1, y1))
-								{
-									map[x1][y1] = 'W';
-								}
-								if (spawn_walls(x2, y2))
-								{
-									map[x2][y2] = 'W';
-								}
-							
-							}
-						}
-					}
-					else // 1,3 ava
-					{
-						if (rand01() >= 0.5) // +1 both 1 and 3 ava
-						{
-							block upper(x1, y1, "up");
-							blocks.push_back(upper);allzeors.push_back(upper);
-							block down(x3, y3, "down");
-							blocks.push_back(down);
-							// 1,3 become 0
-						}
-						else
-						{
-							if (rand01() >= 0.5) // 0: one of 1 and 3 ava
-							{
-								if (rand01() >= 0.5)
-								{
-									block upper(x1, y1, "up");
-									blocks.push_back(upper);allzeors.push_back(upper);
-									
-									if (spawn_walls(x3, y3))
-									{
-										map[x3][y3] = 'W';
-									}
-									// 1 become 0, 3 become W
-								}
-								else
-								{
-									block down(x3, y3, "down");
-									blocks.push_back(down);
-										if (spawn_walls(x1, y1))
-										{
-											map[x1][y1] = 'W';
-										}
-									
-									// 3 become 0, 1 become W
-								}
-							}
-							else // -1 both 1 and 2 block
-							{
-								if (spawn_walls(x1, y1))
-								{
-									map[x1][y1] = 'W';
-								}
-								if (spawn_walls(x2, y2))
-								{
-									map[x2][y2] = 'W';
-								}
-								
-							}
-						}
-					}
-				}
-				else if (ava_block == 3)
-				{
-					if (rand01() <= way3_2) // +2 block 0 way
-					{
-						block upper(x1, y1, "up");
-						blocks.push_back(upper);allzeors.push_back(upper);
-						block left(x2, y2, "left");
-						blocks.push_back(left);allzeors.push_back(left);
-						block down(x3, y3, "down");
-						blocks.push_back(down);
-						// 1,2,3 become 0
-					}
-					else if (rand01() <= way3_1) // +1 random block one way
-					{
-						if (rand01() <= 0.33) // block 1
-						{
-							block left(x2, y2, "left");
-							blocks.push_back(left);allzeors.push_back(left);
-							block down(x3, y3, "down");
-							blocks.push_back(down);
-							if (spawn_walls(x1, y1))
-							{
-								map[x1][y1] = 'W';
-							}
-							
-							// 2,3 become 0
-						}
-						else if (rand01() <= 0.5) // block 2
-						{
-							block upper(x1, y1, "up");
-							blocks.push_back(upper);allzeors.push_back(upper);
-							block down(x3, y3, "down");
-							blocks.push_back(down);
-							
-							if (spawn_walls(x2, y2))
-							{
-								map[x2][y2] = 'W';
-							}
-						
-							// 1,3 become 0
-						}
-						else // block 3
-						{
-							block upper(x1, y1, "up");
-							blocks.push_back(upper);allzeors.push_back(upper);
-							block left(x2, y2, "left");
-							blocks.push_back(left);allzeors.push_back(left);
-							
-							if (spawn_walls(x3, y3))
-							{
-								map[x3][y3] = 'W';
-							}
-							// 1,2 become 0
-						}
-					}
-					else if (rand01() <= way3_0) // -1  block all ways
-					{
-						if (spawn_walls(x1, y1))
-						{
-							map[x1][y1] = 'W';
-						}
-						if (spawn_walls(x2, y2))
-						{
-							map[x2][y2] = 'W';
-						}
-						if (spawn_walls(x3, y3))
-						{
-							map[x3][y3] = 'W';
-						}
-					}
-					else // 0  block two ways
-					{
-						if (rand01() <= 0.33) // leave 1
-						{
-							block upper(x1, y1, "up");
-							blocks.push_back(upper);allzeors.push_back(upper);
-							
-							if (spawn_walls(x2, y2))
-							{
-								map[x2][y2] = 'W';
-							}
-							if (spawn_walls(x3, y3))
-							{
-								map[x3][y3] = 'W';
-							}
-							// 1 become 0
-						}
-						else if (rand01() <= 0.5) // leave 2
-						{
-							block left(x2, y2, "left");
-							blocks.push_back(left);allzeors.push_back(left);
-								if (spawn_walls(x1, y1))
-								{
-									map[x1][y1] = 'W';
-								}
-							
-							if (spawn_walls(x3, y3))
-							{
-								map[x3][y3] = 'W';
-							}
-							// 2 become 0
-						}
-						else // leave 3
-						{
-							block down(x3, y3, "down");
-							blocks.push_back(down);
-								if (spawn_walls(x1, y1))
-								{
-									map[x1][y1] = 'W';
-								}
-							if (spawn_walls(x2, y2))
-							{
-								map[x2][y2] = 'W';
-							}
-							
-							// 3 become 0
-						}
-					}
-				}
-			}
-			else if (block2) //left block is avaliable, upper block is not avaliable
-			{
-				if (ava_block == 1) // only one block avaliable, block 2 avaliable 
-				{
-					if (rand01() <= way1_0) // save it
-					{
-						// block 2 become 0
-						map[x2][y2] = '0';
-						block left(x2, y2, "left");
-						blocks.push_back(left);allzeors.push_back(left);
-					}
-					else // block it
-					{
-						
-						if (spawn_walls(x2, y2))
-						{
-							map[x2][y2] = 'W';
-						}
-						
-					}
-				}
-				else // two block avaliable, which is 2 and 3
-				{
-					if (rand01() <= way2_1) // +1 both 2 and 3 ava
-					{
-						block down(x3, y3, "down");
-						blocks.push_back(down);
-						block left(x2, y2, "left");
-						blocks.push_back(left);allzeors.push_back(left);
-						// 2,3 become 0
-					}
-					else
-					{
-						if (rand01() <= way2_0) // 0: one of 2 and 3 ava
-						{
-							if (rand01() >= 0.5)
-							{
-								block down(x3, y3, "down");
-								blocks.push_back(down);
-								
-								if (spawn_walls(x2, y2))
-								{
-									map[x2][y2] = 'W';
-								}
-								
-								// 3 become 0, 2 become W, 1 is not avaliable
-							}
-							else
-							{
-								block left(x2, y2, "left");
-								blocks.push_back(left);allzeors.push_back(left);
-									
-								if (spawn_walls(x3, y3))
-								{
-									map[x3][y3] = 'W';
-								}
-								// 2 become 0, 3 become W, 1 is not avaliable
-							}
-						}
-						else // -1 both 1 and 2 block
-						{
-							if (spawn_walls(x1, y1))
-							{
-								map[x1][y1] = 'W';
-							}
-							if (spawn_walls(x2, y2))
-							{
-								map[x2][y2] = 'W';
-							}
-							
-						}
-					}
-
-				}
-			}
-			else { // only block 3 is avaliable 
-				if (rand01() <= way1_0) // save it
-				{
-					// block 3 become 0
-					map[x3][y3] = '0';
-					block down(x3, y3, "down");
-					blocks.push_back(down);
-				}
-				else // block it
-				{
-					
-					if (spawn_walls(x3, y3))
-					{
-						map[x3][y3] = 'W';
-					}
-				}
-			}
-			blocks.erase(blocks.begin()); // erase first element
-
-
+			printf("Can't write file '%s'\n", output);
+			return 1;
 		}
-		else if (blocks[0].type == "right")
+		printf("wrote %s: %d x %d chunks, seed %llu, %.1f us per chunk\n", output, w, h, (unsigned long long)seed, seconds * 1e6 / (w * h));
+		return 0;
+	}
+	if (eller)
+	{
+		FILE* out = output != NULL ? fopen(output, "wb") : stdout;
+		if (out == NULL)
 		{
-			// block 2 right
-			int x2 = blocks[0].x+1;
-			int y2 = blocks[0].y;
-			bool block2 = false;
-			// block 3 down
-			int x3 = blocks[0].x;
-			int y3 = blocks[0].y-1;
-			bool block3 = false;
-			// block 1 up
-			int x1 = blocks[0].x;
-			int y1 = blocks[0].y+1;
-			bool block1 = false;
-			//cout << "h";
-			int ava_block = 0;
-			if (x1 >= 0 && x1 < width && y1 >= 0 && y1 < height && map[x1][y1] =='0')
-			{
-				block1 = true;
-				ava_block++;
-			}
-			if (x2 >= 0 && x2 < width && y2 >= 0 && y2 < height && map[x2][y2] =='0')
-			{
-				block2 = true;
-				ava_block++;
-			}
-			if (x3 >= 0 && x3 < width && y3 >= 0 && y3 < height && map[x3][y3] =='0')
-			{
-				block3 = true;
-				ava_block++;
-			}
-			if (ava_block == 0) // no avaliable block
-			{
-				//cout << "h";
-				blocks.erase(blocks.begin()); // erase first element
-				continue;
-			}
-			if (block1) // if the upper block is avaliable
-			{
-				if (ava_block == 1) // only one block avaliable, which one?->block1
-				{
-					if (rand01() <= way1_0) // save it
-					{
-						// block 1 become 0
-						map[x1][y1] = '0';
-						block upper(x1, y1, "up");
-						blocks.push_back(upper);allzeors.push_back(upper);
-					}
-					else // block it
-					{
-						if (spawn_walls(x1, y1))
-						{
-							map[x1][y1] = 'W';
-						}
-						
-					}
-				}
-				else if (ava_block == 2)
-				{
-					if (block2) // 1,2 ava
-					{
-						if (rand01() <= way2_1) // +1 both 1 and 2 ava
-						{
-							block upper(x1, y1, "up");
-							blocks.push_back(upper);allzeors.push_back(upper);
-							block right(x2, y2, "right");
-							blocks.push_back(right);allzeors.push_back(right);
-							// 1,2 become 0
-						}
-						else
-						{
-							if (rand01() <= way2_0) // 0: one of 1 and 2 ava
-							{
-								if (rand01() >= 0.5)
-								{
-									block upper(x1, y1, "up");
-									blocks.push_back(upper);allzeors.push_back(upper);
-									
-									if (spawn_walls(x2, y2))
-									{
-										map[x2][y2] = 'W';
-									}
-									
-									// 1 become 0, 2 become W
-								}
-								else
-								{
-									block right(x2, y2, "right");
-									blocks.push_back(right);allzeors.push_back(right);
-										if (spawn_walls(x1, y1))
-										{
-											map[x1][y1] = 'W';
-										}
-									
-									// 2 become 0, 1 become W
-								}
-							}
-							else // -1 both 1 and 2 block
-							{
-								if (spawn_walls(x1, y1))
-								{
-									map[x1][y1] = 'W';
-								}
-								if (spawn_walls(x2, y2))
-								{
-									map[x2][y2] = 'W';
-								}
-								
-							}
-						}
-					}
-					else // 1,3 ava
-					{
-						if (rand01() >= 0.5) // +1 both 1 and 3 ava
-						{
-							block upper(x1, y1, "up");
-							blocks.push_back(upper);allzeors.push_back(upper);
-							block down(x3, y3, "down");
-							blocks.push_back(down);
-							// 1,3 become 0
-						}
-						else
-						{
-							if (rand01() >= 0.5) // 0: one of 1 and 3 ava
-							{
-								if (rand01() >= 0.5)
-								{
-									block upper(x1, y1, "up");
-									blocks.push_back(upper);allzeors.push_back(upper);
-									
-									if (spawn_walls(x3, y3))
-									{
-										map[x3][y3] = 'W';
-									}
-									// 1 become 0, 3 become W
-								}
-								else
-								{
-									block down(x3, y3, "down");
-									blocks.push_back(down);
-										if (spawn_walls(x1, y1))
-										{
-											map[x1][y1] = 'W';
-										}
-									
-									// 3 become 0, 1 become W
-								}
-							}
-							else // -1 both 1 and 2 block
-							{
-								if (spawn_walls(x1, y1))
-								{
-									map[x1][y1] = 'W';
-								}
-								if (spawn_walls(x2, y2))
-								{
-									map[x2][y2] = 'W';
-								}
-								
-							}
-						}
-					}
-				}
-				else if (ava_block == 3)
-				{
-					if (rand01() <= way3_2) // +2 block 0 way
-					{
-						block upper(x1, y1, "up");
-						blocks.push_back(upper);allzeors.push_back(upper);
-						block right(x2, y2, "right");
-						blocks.push_back(right);allzeors.push_back(right);
-						block down(x3, y3, "down");
-						blocks.push_back(down);
-						// 1,2,3 become 0
-					}
-					else if (rand01() <= way3_1) // +1 random block one way
-					{
-						if (rand01() <= 0.33) // block 1
-						{
-							block right(x2, y2, "right");
-							blocks.push_back(right);allzeors.push_back(right);
-							block down(x3, y3, "down");
-							blocks.push_back(down);
-							if (spawn_walls(x1, y1))
-							{
-								map[x1][y1] = 'W';
-							}
-							
-							// 2,3 become 0
-						}
-						else if (rand01() <= 0.5) // block 2
-						{
-							block upper(x1, y1, "up");
-							blocks.push_back(upper);allzeors.push_back(upper);
-							block down(x3, y3, "down");
-							blocks.push_back(down);
-							
-							if (spawn_walls(x2, y2))
-							{
-								map[x2][y2] = 'W';
-							}
-							
-							// 1,3 become 0
-						}
-						else // block 3
-						{
-							block upper(x1, y1, "up");
-							blocks.push_back(upper);allzeors.push_back(upper);
-							block right(x2, y2, "right");
-							blocks.push_back(right);allzeors.push_back(right);
-							
-							if (spawn_walls(x3, y3))
-							{
-								map[x3][y3] = 'W';
-							}
-							// 1,2 become 0
-						}
-					}
-					else if (rand01() <= way3_0) // -1  block all ways
-					{
-						if (spawn_walls(x1, y1))
-						{
-							map[x1][y1] = 'W';
-						}
-						if (spawn_walls(x2, y2))
-						{
-							map[x2][y2] = 'W';
-						}
-						if (spawn_walls(x3, y3))
-						{
-							map[x3][y3] = 'W';
-						}
-					}
-					else // 0  block two ways
-					{
-						if (rand01() <= 0.33) // leave 1
-						{
-							block upper(x1, y1, "up");
-							blocks.push_back(upper);allzeors.push_back(upper);
-								
-							if (spawn_walls(x2, y2))
-							{
-								map[x2][y2] = 'W';
-							}
-							if (spawn_walls(x3, y3))
-							{
-								map[x3][y3] = 'W';
-							}
-							// 1 become 0
-						}
-						else if (rand01() <= 0.5) // leave 2
-						{
-							block right(x2, y2, "right");
-							blocks.push_back(right);allzeors.push_back(right);
-								if (spawn_walls(x1, y1))
-								{
-									map[x1][y1] = 'W';
-								}
-							
-							if (spawn_walls(x3, y3))
-							{
-								map[x3][y3] = 'W';
-							}
-							// 2 become 0
-						}
-						else // leave 3
-						{
-							block down(x3, y3, "down");
-							blocks.push_back(down);
-								if (spawn_walls(x1, y1))
-								{
-									map[x1][y1] = 'W';
-								}
-							if (spawn_walls(x2, y2))
-							{
-								map[x2][y2] = 'W';
-							}
-							
-							// 3 become 0
-						}
-					}
-				}
-			}
-			else if (block2) //right block is avaliable, upper block is not avaliable
-			{
-				if (ava_block == 1) // only one block avaliable, block 2 avaliable 
-				{
-					if (rand01() <= way1_0) // save it
-					{
-						// block 2 become 0
-						map[x2][y2] = '0';
-						block right(x2, y2, "right");
-						blocks.push_back(right);allzeors.push_back(right);
-					}
-					else // block it
-					{
-						if (spawn_walls(x2, y2))
-						{
-							map[x2][y2] = 'W';
-						}
-					}
-				}
-				else // two block avaliable, which is 2 and 3
-				{
-					if (rand01() <= way2_1) // +1 both 2 and 3 ava
-					{
-						block down(x3, y3, "down");
-						blocks.push_back(down);
-						block right(x2, y2, "right");
-						blocks.push_back(right);allzeors.push_back(right);
-						// 2,3 become 0
-					}
-					else
-					{
-						if (rand01() <= way2_0) // 0: one of 2 and 3 ava
-						{
-							if (rand01() >= 0.5)
-							{
-								block down(x3, y3, "down");
-								blocks.push_back(down);
-								
-								if (spawn_walls(x2, y2))
-								{
-									map[x2][y2] = 'W';
-								}
-								
-								// 3 become 0, 2 become W, 1 is not avaliable
-							}
-							else
-							{
-								block right(x2, y2, "right");
-								blocks.push_back(right);allzeors.push_back(right);
-									
-								if (spawn_walls(x3, y3))
-								{
-									map[x3][y3] = 'W';
-								}
-								// 2 become 0, 3 become W, 1 is not avaliable
-							}
-						}
-						else // -1 both 1 and 2 block
-						{
-							if (spawn_walls(x1, y1))
-							{
-								map[x1][y1] = 'W';
-							}
-							if (spawn_walls(x2, y2))
-							{
-								map[x2][y2] = 'W';
-							}
-							
-						}
-					}
-
-				}
-			}
-			else { // only block 3 is avaliable 
-				if (rand01() <= way1_0) // save it
-				{
-					// block 3 become 0
-					map[x3][y3] = '0';
-					block down(x3, y3, "down");
-					blocks.push_back(down);
-				}
-				else // block it
-				{
-					
-					if (spawn_walls(x3, y3))
-					{
-						map[x3][y3] = 'W';
-					}
-				}
-			}
-			blocks.erase(blocks.begin()); // erase first element
+			printf("Can't write file '%s'\n", output);
+			return 1;
 		}
-		map[x][y] = '0';
-		for (int j = height - 1; j >= 0; j--)
+		static char buffer[1 << 20];
+		setvbuf(out, buffer, _IOFBF, sizeof(buffer));
+		bool ok = generate_eller(out, w, h, seed);
+		ok = (out == stdout ? fflush(out) : fclose(out)) == 0 && ok;
+		if (ok && output != NULL)
 		{
-			for (int i = 0; i <width; i++)
-			{
-
-				cout << map[i][j] << " ";
-			}
-			cout << endl;
+			printf("wrote %s: %d x %d, seed %llu\n", output, w, h, (unsigned long long)seed);
 		}
-		cout << endl << endl;
+		return ok ? 0 : 1;
 	}
-	map[blocks[0].x][blocks[0].y] = 'G';
-	for (int j = height - 1; j >= 0; j--)
+	if (count > 0)
 	{
-		for (int i = 0; i < width; i++)
-		{
-
-			cout << map[i][j] << " ";
-		}
-		cout << endl;
+		debug_steps = false;
+		string prefix = output != NULL ? output : "maze";
+		int digits = (int)to_string(count - 1).size();
+		if (digits < 5)
+			digits = 5;
+		atomic<int> failed(0);
+		auto begin = chrono::steady_clock::now();
+		parallelFor(count, [&](int i) {
+			maze_rng rng(seed, i);
+			map_buffer map;
+			char name[32];
+			snprintf(name, sizeof(name), "%0*d.txt", digits, i);
+			if (!generate_maze(*engine, map, w, h, keys, rng) || !map.save((prefix + name).c_str()))
+			{
+				failed++;
+			}
+		}, threads);
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+		printf("wrote %d mazes %d x %d (%s%0*d.txt ...), seed %llu: %.3f s, %.0f mazes/s\n", count - (int)failed, w, h,
+			prefix.c_str(), digits, 0, (unsigned long long)seed, seconds, count / seconds);
+		return failed > 0 ? 1 : 0;
 	}
-	cout << endl << endl;
-}
 
-int main()
-{
-	generate_map(5, 5, 0);
+	carve_threads = threads;
+	maze_rng rng(seed);
+	map_buffer map;
+	if (!generate_maze(*engine, map, w, h, keys, rng, output))
+	{
+		if (output != NULL)
+			remove(output); // the map file is made before carving
+		return 1;
+	}
+	if (output == NULL)
+	{
+		return map.write(stdout) && fflush(stdout) == 0 ? 0 : 1;
+	}
+	if (!map.save(output))
+	{
+		printf("Can't write file '%s'\n", output);
+		return 1;
+	}
+	printf("wrote %s: %d x %d, seed %llu\n", output, w, h, (unsigned long long)seed);
 	return 0;
-}
\ No newline at end of file
+}
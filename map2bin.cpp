@@ -0,0 +1,33 @@
+// Converts a text map (map1.txt, map6.txt, ...) into the binary map format in mapformat.h.
+// the game loads either one with parseMapFile, the binary one needs no parsing pass.
+// -t writes the walls as 256x256 tiles, the game then pages them in from disk
+// (tilestore.h) instead of loading the whole map, for maps bigger than memory.
+// a binary map can be the input too, to tile or untile it.
+//
+//Linux build: g++ -O2 map2bin.cpp -o map2bin -pthread
+//usage:       ./map2bin [-t] map6.txt map6.bin
+
+#include "parse.h"
+
+int main(int argc, char* argv[])
+{
+	bool tiled = argc > 1 && strcmp(argv[1], "-t") == 0;
+	if (argc != (tiled ? 4 : 3))
+	{
+		printf("usage: %s [-t] <map.txt> <map.bin>\n", argv[0]);
+		return 1;
+	}
+	const char* input = argv[tiled ? 2 : 1];
+	const char* output = argv[tiled ? 3 : 2];
+	MazeInstance maze;
+	parseMapFile(maze, input);
+	if (!writeMapBinary(maze, output, tiled))
+	{
+		return 1;
+	}
+	if (maze.grid.wordsPerRow == 0) // paged in, the walls were never all in memory to count
+		printf("wrote %s: %d x %d, %d doors%s\n", output, maze.grid.width, maze.grid.height, (int)maze.player.doors.size(), tiled ? ", tiled" : "");
+	else
+		printf("wrote %s: %d x %d, %d walls, %d doors%s\n", output, maze.grid.width, maze.grid.height, (int)maze.grid.wallCount(), (int)maze.player.doors.size(), tiled ? ", tiled" : "");
+	return 0;
+}
@@ -0,0 +1,238 @@
+#pragma once
+#include "parse.h"
+#include "mapformat.h"
+#include "tilestore.h"
+// reading and writing the binary map files described in mapformat.h
+
+// write a maze (grid + doors) as a binary map file, tiled for maps that
+// should be paged from disk (see tilestore.h). a paged grid has no rows in memory,
+// its walls are read back tile by tile from its TileStore
+bool writeMapBinary(const MazeInstance& maze, std::string fileName, bool tiled = false)
+{
+	TileStore* paged = maze.grid.wordsPerRow == 0 ? maze.grid.tiles.get() : NULL;
+	if (maze.grid.wordsPerRow == 0 && paged == NULL && maze.grid.width > 0)
+	{
+		std::cout << "No wall bits to write to '" << fileName << "'" << std::endl;
+		return false;
+	}
+	int wordsPerRow = (maze.grid.width + 63) / 64;
+	FILE* out = fopen(fileName.c_str(), "wb");
+	if (out == NULL)
+	{
+		std::cout << "Can't write file '" << fileName << "'" << std::endl;
+		return false;
+	}
+	std::vector<MapBinEntity> entityList;
+	entityList.reserve(maze.grid.entities.size());
+	for (std::unordered_map<uint64_t, Entity>::const_iterator it = maze.grid.entities.begin(); it != maze.grid.entities.end(); ++it)
+	{
+		MapBinEntity e;
+		e.x = (int32_t)(it->first % maze.grid.width);
+		e.y = (int32_t)(it->first / maze.grid.width);
+		e.type = it->second.type;
+		e.index = it->second.index;
+		entityList.push_back(e);
+	}
+
+	MapBinHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MAPBIN_MAGIC, 4);
+	header.version = MAPBIN_VERSION;
+	header.width = maze.grid.width;
+	header.height = maze.grid.height;
+	header.wordsPerRow = wordsPerRow;
+	header.flags = tiled ? MAPBIN_TILED : 0;
+	header.doorCount = (uint32_t)maze.player.doors.size();
+	header.entityCount = (uint32_t)entityList.size();
+	header.doorOffset = mapBinAlign(sizeof(MapBinHeader));
+	header.wallOffset = mapBinAlign(header.doorOffset + header.doorCount * sizeof(MapBinDoor));
+	header.entityOffset = mapBinAlign(header.wallOffset + mapBinWallBytes(header));
+	fwrite(&header, sizeof(header), 1, out);
+
+	for (size_t i = 0; i < maze.player.doors.size(); i++)
+	{
+		MapBinDoor d;
+		memset(&d, 0, sizeof(d));
+		d.doorx = maze.player.doors[i].doorx;
+		d.doory = maze.player.doors[i].doory;
+		d.keyx = maze.player.doors[i].keyhomex;
+		d.keyy = maze.player.doors[i].keyhomey;
+		d.door = maze.player.doors[i].door;
+		d.key = maze.player.doors[i].key;
+		d.id = maze.player.doors[i].id;
+		fwrite(&d, sizeof(d), 1, out);
+	}
+	char zeros[8] = { 0 };
+	fwrite(zeros, 1, header.wallOffset - (header.doorOffset + header.doorCount * sizeof(MapBinDoor)), out);
+	if (tiled)
+	{
+		// cut every tile out of the rows, the parts past the map edge stay 0
+		std::vector<uint64_t> tile(TILE_WORDS);
+		for (int ty = 0; ty < mapBinTilesY(header.height); ty++)
+		{
+			for (int tx = 0; tx < mapBinTilesX(header.width); tx++)
+			{
+				if (paged != NULL) // already cut the same way
+				{
+					fwrite(paged->tileBits(tx, ty), sizeof(uint64_t), TILE_WORDS, out);
+					continue;
+				}
+				std::fill(tile.begin(), tile.end(), 0);
+				for (int r = 0; r < TILE_SIZE && ty * TILE_SIZE + r < maze.grid.height; r++)
+				{
+					const uint64_t* row = maze.grid.row(ty * TILE_SIZE + r);
+					for (int w = 0; w < TILE_WORDS_PER_ROW && tx * TILE_WORDS_PER_ROW + w < maze.grid.wordsPerRow; w++)
+					{
+						tile[r * TILE_WORDS_PER_ROW + w] = row[tx * TILE_WORDS_PER_ROW + w];
+					}
+				}
+				fwrite(tile.data(), sizeof(uint64_t), TILE_WORDS, out);
+			}
+		}
+	}
+	else if (paged != NULL)
+	{
+		// put the rows back together a tile row at a time
+		std::vector<uint64_t> band((size_t)TILE_SIZE * wordsPerRow);
+		for (int ty = 0; ty < mapBinTilesY(header.height); ty++)
+		{
+			int rows = std::min(TILE_SIZE, maze.grid.height - ty * TILE_SIZE);
+			for (int tx = 0; tx < mapBinTilesX(header.width); tx++)
+			{
+				const uint64_t* bits = paged->tileBits(tx, ty);
+				for (int r = 0; r < rows; r++)
+				{
+					for (int w = 0; w < TILE_WORDS_PER_ROW && tx * TILE_WORDS_PER_ROW + w < wordsPerRow; w++)
+					{
+						band[(size_t)r * wordsPerRow + tx * TILE_WORDS_PER_ROW + w] = bits[r * TILE_WORDS_PER_ROW + w];
+					}
+				}
+			}
+			fwrite(band.data(), sizeof(uint64_t), (size_t)rows * wordsPerRow, out);
+		}
+	}
+	else
+	{
+		fwrite(maze.grid.words(), sizeof(uint64_t), maze.grid.wordCount(), out);
+	}
+	if (!entityList.empty())
+	{
+		fwrite(entityList.data(), sizeof(MapBinEntity), entityList.size(), out);
+	}
+	bool ok = !ferror(out);
+	fclose(out);
+	return ok;
+}
+
+// load a binary map that starts at base inside input without a parsing pass: the grid
+// looks at the wall bits inside the mapping, only the (small) door table and entity
+// list are copied out. tiled maps keep their walls on disk, the grid pages them in
+// through a TileStore. base is 0 for a .bin file, the level offset in a pack
+// (mappack.h), and must be a multiple of 8 so the wall bits stay aligned.
+bool loadMapBinaryAt(MazeInstance& maze, std::shared_ptr<MappedFile> input, std::string fileName, size_t base, size_t size)
+{
+	const char* data = input->data() + base;
+	if (base % 8 != 0 || base + size > input->size() || !isMapBinary(data, size))
+	{
+		std::cout << "Not a binary map file" << std::endl;
+		return false;
+	}
+	MapBinHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (header.version < 1 || header.version > MAPBIN_VERSION ||
+		header.wordsPerRow != (header.width + 63) / 64 ||
+		header.doorOffset + (uint64_t)header.doorCount * sizeof(MapBinDoor) > size ||
+		header.wallOffset % 8 != 0 || header.wallOffset + mapBinWallBytes(header) > size ||
+		header.entityOffset + (uint64_t)header.entityCount * sizeof(MapBinEntity) > size)
+	{
+		std::cout << "Bad binary map file (version " << header.version << ")" << std::endl;
+		return false;
+	}
+	// doors and keys index the door table, collision and move_key trust that index
+	const MapBinEntity* entityList = (const MapBinEntity*)(data + header.entityOffset);
+	for (uint32_t i = 0; i < header.entityCount; i++)
+	{
+		const MapBinEntity& e = entityList[i];
+		bool indexed = e.type == CELL_DOOR || e.type == CELL_KEY;
+		if ((!indexed && e.type != CELL_START && e.type != CELL_GOAL) ||
+			(indexed && (e.index < 0 || (uint32_t)e.index >= header.doorCount)))
+		{
+			std::cout << "Bad binary map file (entity " << i << ": type " << e.type << ", door " << e.index << ")" << std::endl;
+			return false;
+		}
+	}
+	// door and key cells get written into the grid and flood boards without a check
+	const MapBinDoor* doorTable = (const MapBinDoor*)(data + header.doorOffset);
+	for (uint32_t i = 0; i < header.doorCount; i++)
+	{
+		const MapBinDoor& d = doorTable[i];
+		if (!mapBinInside(header, d.doorx, d.doory) || !mapBinInside(header, d.keyx, d.keyy))
+		{
+			std::cout << "Bad binary map file (door " << i << " at " << d.doorx << "," << d.doory
+				<< ", key at " << d.keyx << "," << d.keyy << ")" << std::endl;
+			return false;
+		}
+	}
+
+	maze.width = header.width;
+	maze.height = header.height;
+	if (header.flags & MAPBIN_TILED)
+	{
+		std::shared_ptr<TileStore> store(new TileStore());
+		if (!store->open(fileName, 64, base))
+		{
+			std::cout << "Can't page tiles from '" << fileName << "'" << std::endl;
+			return false;
+		}
+		maze.grid.page(store);
+	}
+	else
+	{
+		maze.grid.view(input, (const uint64_t*)(data + header.wallOffset), maze.width, maze.height);
+	}
+
+	maze.player.doors.resize(header.doorCount);
+	maze.player.doorByTag.clear();
+	for (uint32_t i = 0; i < header.doorCount; i++)
+	{
+		maze.player.doors[i].doorx = doorTable[i].doorx;
+		maze.player.doors[i].doory = doorTable[i].doory;
+		maze.player.doors[i].keyx = maze.player.doors[i].keyhomex = doorTable[i].keyx;
+		maze.player.doors[i].keyy = maze.player.doors[i].keyhomey = doorTable[i].keyy;
+		maze.player.doors[i].door = doorTable[i].door;
+		maze.player.doors[i].key = doorTable[i].key;
+		if (header.version >= 2)
+			maze.player.doors[i].id = doorTable[i].id;
+		else // letters only
+			maze.player.doors[i].id = doorTable[i].door ? doorTable[i].door - 'A' : doorTable[i].key - 'a';
+		maze.player.doors[i].colorFromTag();
+		maze.player.doorByTag[maze.player.doors[i].id] = (int)i;
+	}
+
+	maze.grid.entities.reserve(header.entityCount);
+	for (uint32_t i = 0; i < header.entityCount; i++)
+	{
+		const MapBinEntity& e = entityList[i];
+		if (!maze.grid.inside(e.x, e.y))
+		{
+			continue;
+		}
+		maze.grid.setEntity(e.x, e.y, e.type, e.index);
+		if (e.type == CELL_START)
+		{
+			maze.player.Playerx = maze.player.startx = e.x;
+			maze.player.Playery = maze.player.starty = e.y;
+		}
+		else if (e.type == CELL_GOAL)
+		{
+			maze.player.goalx = e.x;
+			maze.player.goaly = e.y;
+		}
+	}
+	return true;
+}
+
+bool loadMapBinary(MazeInstance& maze, std::shared_ptr<MappedFile> input, std::string fileName)
+{
+	return loadMapBinaryAt(maze, input, fileName, 0, input->size());
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <cstdio>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <fstream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+// read-only view of a whole file so the map loaders can walk it in one pass.
+// on linux/mac the file is mmap'd (no copy at all), on windows we fall back to
+// reading it into one buffer.
+class MappedFile {
+public:
+	MappedFile() {}
+	~MappedFile()
+	{
+		close();
+	}
+	bool open(const std::string& fileName)
+	{
+		close();
+#ifdef _WIN32
+		std::ifstream input(fileName.c_str(), std::ios::binary);
+		if (input.fail())
+		{
+			return false;
+		}
+		input.seekg(0, std::ios::end);
+		buffer.resize((size_t)input.tellg());
+		input.seekg(0, std::ios::beg);
+		input.read(buffer.data(), buffer.size());
+		ptr = buffer.data();
+		len = buffer.size();
+		return true;
+#else
+		int fd = ::open(fileName.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) != 0)
+		{
+			::close(fd);
+			return false;
+		}
+		len = (size_t)info.st_size;
+		if (len > 0) // mmap refuses empty files, an empty map is just an empty view
+		{
+			void* addr = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (addr == MAP_FAILED)
+			{
+				::close(fd);
+				len = 0;
+				return false;
+			}
+			madvise(addr, len, MADV_SEQUENTIAL);
+			ptr = (const char*)addr;
+		}
+		::close(fd); // the mapping stays valid after the descriptor is closed
+		return true;
+#endif
+	}
+	void close()
+	{
+#ifdef _WIN32
+		buffer.clear();
+#else
+		if (ptr != NULL)
+		{
+			munmap((void*)ptr, len);
+		}
+#endif
+		ptr = NULL;
+		len = 0;
+	}
+	const char* data() const
+	{
+		return ptr;
+	}
+	size_t size() const
+	{
+		return len;
+	}
+	// hint that [offset, offset + bytes) is about to be read so the kernel starts
+	// reading it in now (a level in a pack, see mappack.h)
+	void willNeed(size_t offset, size_t bytes)
+	{
+#ifndef _WIN32
+		if (ptr == NULL || offset >= len)
+		{
+			return;
+		}
+		size_t page = (size_t)sysconf(_SC_PAGESIZE);
+		size_t start = offset / page * page;
+		if (bytes > len - offset)
+		{
+			bytes = len - offset;
+		}
+		madvise((void*)(ptr + start), offset + bytes - start, MADV_WILLNEED);
+#endif
+	}
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+	const char* ptr = NULL;
+	size_t len = 0;
+#ifdef _WIN32
+	std::vector<char> buffer;
+#endif
+};
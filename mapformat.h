@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+// binary map files (.bin), written by map2bin and loaded by parseMapFile when the
+// file starts with "MAZB". the file is laid out so it can be used straight from mmap:
+//
+//   MapBinHeader
+//   MapBinDoor  x doorCount      (the door/key table, same order as player.doors)
+//   uint64_t    x wordsPerRow * height   (wall bits, exactly the Grid layout, row 0 first)
+//   MapBinEntity x entityCount   (start, goal, every door and key cell)
+//
+// every section starts on an 8 byte boundary. numbers are little endian.
+//
+// with MAPBIN_TILED set in flags the wall bits are stored as 256x256 tiles instead of
+// whole rows (tile rows bottom up, tiles left to right inside a tile row). one tile
+// is 256 rows of 4 words, 8 KB, and can be read with a single seek (see tilestore.h).
+const char MAPBIN_MAGIC[4] = { 'M', 'A', 'Z', 'B' };
+// version 2 added the pairing tag to the door table, version 1 files only had letters
+const uint32_t MAPBIN_VERSION = 2;
+const uint32_t MAPBIN_TILED = 1;
+
+// most door/key pairs a map can have: what generate.h places at most and what the
+// solver (solver.h) has key mask bits for
+const int MAX_KEY_PAIRS = 20;
+
+const int TILE_SIZE = 256;
+const int TILE_WORDS_PER_ROW = TILE_SIZE / 64;
+const size_t TILE_WORDS = (size_t)TILE_SIZE * TILE_WORDS_PER_ROW;
+const size_t TILE_BYTES = TILE_WORDS * sizeof(uint64_t);
+
+struct MapBinHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t wordsPerRow;
+	uint32_t doorCount;
+	uint32_t entityCount;
+	uint32_t flags;
+	uint64_t doorOffset;
+	uint64_t wallOffset;
+	uint64_t entityOffset;
+};
+struct MapBinDoor {
+	int32_t doorx;
+	int32_t doory;
+	int32_t keyx;
+	int32_t keyy;
+	char door;
+	char key;
+	char pad[2];
+	int32_t id;
+};
+struct MapBinEntity {
+	int32_t x;
+	int32_t y;
+	int32_t type;
+	int32_t index;
+};
+
+inline uint64_t mapBinAlign(uint64_t offset)
+{
+	return (offset + 7) & ~(uint64_t)7;
+}
+
+inline bool isMapBinary(const char* data, size_t size)
+{
+	return size >= sizeof(MapBinHeader) && memcmp(data, MAPBIN_MAGIC, 4) == 0;
+}
+
+inline int mapBinTilesX(uint32_t width)
+{
+	return (int)((width + TILE_SIZE - 1) / TILE_SIZE);
+}
+
+inline int mapBinTilesY(uint32_t height)
+{
+	return (int)((height + TILE_SIZE - 1) / TILE_SIZE);
+}
+
+// a door table cell is on the map (unused door or key cells are 0,0)
+inline bool mapBinInside(const MapBinHeader& header, int32_t x, int32_t y)
+{
+	return x >= 0 && y >= 0 && (uint32_t)x < header.width && (uint32_t)y < header.height;
+}
+
+// bytes taken by the wall section
+inline uint64_t mapBinWallBytes(const MapBinHeader& header)
+{
+	if (header.flags & MAPBIN_TILED)
+	{
+		return (uint64_t)mapBinTilesX(header.width) * mapBinTilesY(header.height) * TILE_BYTES;
+	}
+	return (uint64_t)header.wordsPerRow * header.height * sizeof(uint64_t);
+}
@@ -0,0 +1,49 @@
+// Builds a level pack (mappack.h) out of map files, text or binary, in play order.
+// the game takes a pack in place of a map file and moves on to the next level
+// every time the goal is reached.
+// -l lists the levels in a pack, and exits 1 if any of them can't be loaded.
+//
+//Linux build: g++ -O2 mappack.cpp -o mappack -pthread
+//usage:       ./mappack campaign.pack map1.txt map2.txt map6.bin ...
+//             ./mappack -l campaign.pack
+
+#include "mappack.h"
+
+int main(int argc, char* argv[])
+{
+	if (argc == 3 && strcmp(argv[1], "-l") == 0)
+	{
+		MapPack pack;
+		if (!pack.open(argv[2]))
+		{
+			printf("%s is not a level pack\n", argv[2]);
+			return 1;
+		}
+		int failed = 0;
+		for (int i = 0; i < pack.levelCount(); i++)
+		{
+			MazeInstance maze;
+			if (!pack.load(maze, i))
+			{
+				printf("%3d  %-24s can't be loaded\n", i, pack.levelName(i).c_str());
+				failed++;
+				continue;
+			}
+			printf("%3d  %-24s %d x %d, %d doors\n", i, pack.levelName(i).c_str(), maze.width, maze.height, (int)maze.player.doors.size());
+		}
+		return failed > 0 ? 1 : 0;
+	}
+	if (argc < 3)
+	{
+		printf("usage: %s <out.pack> <map> [<map> ...]\n", argv[0]);
+		printf("       %s -l <pack>\n", argv[0]);
+		return 1;
+	}
+	std::vector<std::string> maps(argv + 2, argv + argc);
+	if (!writeMapPack(maps, argv[1]))
+	{
+		return 1;
+	}
+	printf("wrote %s: %d levels\n", argv[1], (int)maps.size());
+	return 0;
+}
@@ -0,0 +1,219 @@
+#pragma once
+#include <future>
+#include "parse.h"
+// level packs (.pack), written by mappack: many maps in one file with an offset table
+// up front, so any level is found with one lookup and read with one seek (with mmap
+// not even that), and no file is opened per level.
+//
+//   MapPackHeader
+//   MapPackLevel x levelCount    (offset and size of every level, in play order)
+//   level data                   (each a text map or a binary map as is, 8 byte aligned)
+//
+// levels are stored byte for byte as their map files, so a binary level is loaded
+// straight out of the pack mapping like a .bin file is.
+const char MAPPACK_MAGIC[4] = { 'M', 'Z', 'P', 'K' };
+const uint32_t MAPPACK_VERSION = 1;
+const int MAPPACK_NAME_LENGTH = 48;
+
+struct MapPackHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t levelCount;
+	uint32_t pad;
+	uint64_t indexOffset;
+};
+struct MapPackLevel {
+	uint64_t offset;
+	uint64_t size;
+	char name[MAPPACK_NAME_LENGTH]; // file the level came from, 0 terminated
+};
+
+inline bool isMapPack(const char* data, size_t size)
+{
+	return size >= sizeof(MapPackHeader) && memcmp(data, MAPPACK_MAGIC, 4) == 0;
+}
+
+// concatenate map files (text or binary) into one pack
+bool writeMapPack(const std::vector<std::string>& mapFiles, std::string fileName)
+{
+	std::vector<MapPackLevel> index(mapFiles.size());
+	MapPackHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MAPPACK_MAGIC, 4);
+	header.version = MAPPACK_VERSION;
+	header.levelCount = (uint32_t)mapFiles.size();
+	header.indexOffset = mapBinAlign(sizeof(MapPackHeader));
+
+	std::vector<std::shared_ptr<MappedFile> > inputs(mapFiles.size());
+	uint64_t offset = mapBinAlign(header.indexOffset + index.size() * sizeof(MapPackLevel));
+	for (size_t i = 0; i < mapFiles.size(); i++)
+	{
+		inputs[i].reset(new MappedFile());
+		if (!inputs[i]->open(mapFiles[i]))
+		{
+			std::cout << "Can't open file '" << mapFiles[i] << "'" << std::endl;
+			return false;
+		}
+		memset(&index[i], 0, sizeof(MapPackLevel));
+		index[i].offset = offset;
+		index[i].size = inputs[i]->size();
+		size_t slash = mapFiles[i].find_last_of("/\\");
+		std::string name = slash == std::string::npos ? mapFiles[i] : mapFiles[i].substr(slash + 1);
+		strncpy(index[i].name, name.c_str(), MAPPACK_NAME_LENGTH - 1);
+		offset = mapBinAlign(offset + index[i].size);
+	}
+
+	FILE* out = fopen(fileName.c_str(), "wb");
+	if (out == NULL)
+	{
+		std::cout << "Can't write file '" << fileName << "'" << std::endl;
+		return false;
+	}
+	char zeros[8] = { 0 };
+	fwrite(&header, sizeof(header), 1, out);
+	fwrite(zeros, 1, header.indexOffset - sizeof(header), out);
+	if (!index.empty())
+	{
+		fwrite(index.data(), sizeof(MapPackLevel), index.size(), out);
+	}
+	uint64_t written = header.indexOffset + index.size() * sizeof(MapPackLevel);
+	for (size_t i = 0; i < index.size(); i++)
+	{
+		fwrite(zeros, 1, index[i].offset - written, out);
+		if (index[i].size > 0)
+		{
+			fwrite(inputs[i]->data(), 1, index[i].size, out);
+		}
+		written = index[i].offset + index[i].size;
+	}
+	bool ok = !ferror(out);
+	fclose(out);
+	return ok;
+}
+
+// an open pack. load(maze, n) fills maze with level n, prefetch(n) starts loading
+// level n on another thread so the load() for it at the end of a level is instant.
+class MapPack {
+public:
+	MapPack() {}
+	~MapPack()
+	{
+		close();
+	}
+	// false (quietly) if fileName is not a pack, so callers can fall back to a map file
+	bool open(const std::string& fileName)
+	{
+		close();
+		std::shared_ptr<MappedFile> input(new MappedFile());
+		if (!input->open(fileName) || !isMapPack(input->data(), input->size()))
+		{
+			return false;
+		}
+		MapPackHeader header;
+		memcpy(&header, input->data(), sizeof(header));
+		if (header.version != MAPPACK_VERSION || header.indexOffset + (uint64_t)header.levelCount * sizeof(MapPackLevel) > input->size())
+		{
+			std::cout << "Bad level pack '" << fileName << "' (version " << header.version << ")" << std::endl;
+			return false;
+		}
+		index.resize(header.levelCount);
+		if (header.levelCount > 0)
+		{
+			memcpy(index.data(), input->data() + header.indexOffset, header.levelCount * sizeof(MapPackLevel));
+		}
+		for (size_t i = 0; i < index.size(); i++)
+		{
+			index[i].name[MAPPACK_NAME_LENGTH - 1] = 0;
+			if (index[i].offset + index[i].size > input->size())
+			{
+				std::cout << "Bad level pack '" << fileName << "': level " << i << " is cut off" << std::endl;
+				index.clear();
+				return false;
+			}
+		}
+		this->fileName = fileName;
+		file = input;
+		return true;
+	}
+	void close()
+	{
+		if (pending.valid())
+		{
+			pending.wait();
+		}
+		pending = std::future<bool>();
+		pendingLevel = -1;
+		pendingMaze = MazeInstance();
+		index.clear();
+		file.reset();
+	}
+	int levelCount() const
+	{
+		return (int)index.size();
+	}
+	std::string levelName(int level) const
+	{
+		return level >= 0 && level < levelCount() ? index[level].name : "";
+	}
+	// replaces maze with level n. takes the prefetched copy when there is one
+	bool load(MazeInstance& maze, int level)
+	{
+		if (pending.valid())
+		{
+			bool ok = pending.get(); // waits if the prefetch is not done yet
+			if (pendingLevel == level)
+			{
+				maze = std::move(pendingMaze);
+				pendingMaze = MazeInstance();
+				pendingLevel = -1;
+				return ok;
+			}
+			pendingMaze = MazeInstance();
+			pendingLevel = -1;
+		}
+		maze = MazeInstance();
+		return loadLevel(maze, level);
+	}
+	// start reading and parsing level n in the background, load(maze, n) picks it up
+	void prefetch(int level)
+	{
+		if (level < 0 || level >= levelCount() || level == pendingLevel)
+		{
+			return;
+		}
+		if (pending.valid())
+		{
+			pending.wait();
+		}
+		file->willNeed((size_t)index[level].offset, (size_t)index[level].size);
+		pendingLevel = level;
+		pendingMaze = MazeInstance();
+		pending = std::async(std::launch::async, [this, level]() { return loadLevel(pendingMaze, level); });
+	}
+private:
+	std::string fileName;
+	std::shared_ptr<MappedFile> file;
+	std::vector<MapPackLevel> index;
+	std::future<bool> pending;
+	int pendingLevel = -1;
+	MazeInstance pendingMaze;
+
+	bool loadLevel(MazeInstance& maze, int level)
+	{
+		if (level < 0 || level >= levelCount())
+		{
+			std::cout << "No level " << level << " in '" << fileName << "'" << std::endl;
+			return false;
+		}
+		const MapPackLevel& entry = index[level];
+		const char* data = file->data() + entry.offset;
+		if (isMapBinary(data, (size_t)entry.size))
+		{
+			return loadMapBinaryAt(maze, file, fileName, (size_t)entry.offset, (size_t)entry.size);
+		}
+		parseMapBuffer(maze, data, (size_t)entry.size);
+		return true;
+	}
+	MapPack(const MapPack&);
+	MapPack& operator=(const MapPack&);
+};
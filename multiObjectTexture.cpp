@@ -22,7 +22,7 @@ const char* INSTRUCTIONS =
 ;
 
 //Mac OS build: g++ multiObjectTest.cpp -x c glad/glad.c -g -F/Library/Frameworks -framework SDL2 -framework OpenGL -o MultiObjTest
-//Linux build:  g++ multiObjectTest.cpp -x c glad/glad.c -g -lSDL2 -lSDL2main -lGL -ldl -I/usr/include/SDL2/ -o MultiObjTest
+//Linux build:  g++ multiObjectTest.cpp -x c glad/glad.c -g -lSDL2 -lSDL2main -lGL -ldl -pthread -I/usr/include/SDL2/ -o MultiObjTest
 
 #include "glad/glad.h"  //Include order can matter here
 #if defined(__APPLE__) || defined(__linux__)
@@ -44,11 +44,16 @@ const char* INSTRUCTIONS =
 #include <fstream>
 #include <string>
 #include "parse.h"
+#include "gameplay.h"
+#include "hotreload.h"
+#include "mappack.h"
 #include <math.h>       
 #include "loadmodel.h"
 
 
 #define PI 3.14159265
+// the far plane is 10 away, nothing further than this many cells can be seen
+const int VIEW_CELLS = 11;
 using namespace std;
 
 int screenWidth = 800; 
@@ -76,11 +81,10 @@ float rand01(){
 }
 
 void drawGeometry(int shaderProgram, int model1_start, int model1_numVerts, int model2_start, int model2_numVerts);
-void drawWalls(int shaderProgram, int model1_start, int model1_numVerts);
-void drawFloors(int shaderProgram, int model1_start, int model1_numVerts);
-void drawGoal(int shaderProgram, int model1_start, int model1_numVerts);
+void drawWalls(int shaderProgram, int model1_start, int model1_numVerts, const MazeInstance& maze, float camx, float camy);
+void drawFloors(int shaderProgram, int model1_start, int model1_numVerts, const MazeInstance& maze, float camx, float camy);
+void drawGoal(int shaderProgram, int model1_start, int model1_numVerts, const MazeInstance& maze);
 void drawKey_Door(int shaderProgram, int model1_start, int model1_numVerts, float xoffset, float yoffset, float zoffset, float r, float g, float b, bool key);
-void move_key(float x, float y, float viewx, float viewy);
 bool jump(float time, float& playerz);
 // build a mesh based on x and y cor, and their type
 // type 1 = wall
@@ -90,9 +94,33 @@ bool jump(float time, float& playerz);
 // type 5 = goal;
 
 void build_mesh(int x, int y, int type); 
-bool collision(float x, float y);
 int main(int argc, char* argv[]) {
-	parseMapFile("map6.txt"); // read map
+	// a map file, or a level pack (mappack.h) and the level to start at
+	const char* mapFile = argc > 1 ? argv[1] : "map6.txt";
+	MazeInstance maze;
+	MapPack pack;
+	int level = 0;
+	bool packMode = pack.open(mapFile);
+	MapWatcher mapWatcher; // pick up edits to the map while the game runs
+	if (packMode)
+	{
+		level = argc > 2 ? atoi(argv[2]) : 0;
+		if (level < 0 || level >= pack.levelCount())
+			level = 0;
+		if (!pack.load(maze, level))
+		{
+			printf("Can't load level %d of %s\n", level + 1, mapFile);
+			return 1;
+		}
+		pack.prefetch(level + 1); // ready by the time this level is done
+		printf("Level %d of %d: %s\n", level + 1, pack.levelCount(), pack.levelName(level).c_str());
+	}
+	else
+	{
+		parseMapFile(maze, mapFile); // read map
+		mapWatcher.watch(mapFile);
+	}
+	buildFlowField(maze); // which way to the goal from every cell
 	SDL_Init(SDL_INIT_VIDEO);  //Initialize Graphics (for OpenGL)
 
 	//Ask SDL to get a recent version of OpenGL (3.2 or greater)
@@ -299,8 +327,8 @@ int main(int argc, char* argv[]) {
 	//Event Loop (Loop forever processing each event as fast as possible)
 	SDL_Event windowEvent;
 	bool quit = false;
-	float camx = player.Playerx;
-	float camy = player.Playery;
+	float camx = maze.player.Playerx;
+	float camy = maze.player.Playery;
 	float camz = 0;
 	float angel = 0;
 	bool jumping = false;
@@ -311,6 +339,22 @@ int main(int argc, char* argv[]) {
 			jumping = jump(time, camz);
 			time += 0.1;
 		}
+		if (!packMode && mapWatcher.changed()) // the map was saved: patch the running maze
+		{
+			Uint32 reloadStart = SDL_GetTicks();
+			MapDiff diff;
+			if (reloadMap(maze, mapFile, diff))
+			{
+				printf("Reloaded %s in %u ms: %d walls added, %d removed, doors %d added, %d removed, %d moved%s\n", mapFile, SDL_GetTicks() - reloadStart,
+					(int)diff.addedWalls.size(), (int)diff.removedWalls.size(), diff.doorsAdded, diff.doorsRemoved, diff.doorsMoved, diff.resized ? " (new size)" : "");
+				buildFlowField(maze);
+				if (maze.grid.isWall((int)floor(camx + 0.5), (int)floor(camy + 0.5))) // walled in, back to the start
+				{
+					camx = maze.player.startx;
+					camy = maze.player.starty;
+				}
+			}
+		}
 		while (SDL_PollEvent(&windowEvent)) {  //inspect all events in the queue
 			if (windowEvent.type == SDL_QUIT) quit = true;
 			//List of keycodes: https://wiki.libsdl.org/SDL_Keycode - You can catch many special keys
@@ -321,11 +365,25 @@ int main(int argc, char* argv[]) {
 				fullscreen = !fullscreen;
 				SDL_SetWindowFullscreen(window, fullscreen ? SDL_WINDOW_FULLSCREEN : 0); //Toggle fullscreen 
 			}
-			if (player.goal)// reach the goal
+			if (maze.player.goal)// reach the goal
 			{
-				player.goal = false;
-				camx = player.Playerx;
-				camy = player.Playery;
+				maze.player.goal = false;
+				if (packMode && pack.levelCount() > 1) // on to the next level, it was prefetched
+				{
+					int next = (level + 1) % pack.levelCount();
+					if (pack.load(maze, next))
+						level = next;
+					else if (!pack.load(maze, level)) // play this one again
+					{
+						printf("Can't load level %d or %d of %s\n", next + 1, level + 1, mapFile);
+						quit = true;
+					}
+					pack.prefetch((level + 1) % pack.levelCount());
+					printf("Level %d of %d: %s\n", level + 1, pack.levelCount(), pack.levelName(level).c_str());
+					buildFlowField(maze);
+				}
+				camx = maze.player.Playerx;
+				camy = maze.player.Playery;
 			}
 
 			//SJG: Use key input to change the state of the object
@@ -343,23 +401,23 @@ int main(int argc, char* argv[]) {
 			if (windowEvent.type == SDL_KEYDOWN && windowEvent.key.keysym.sym == SDLK_UP) { //If "up key" is pressed
 				camx += 0.1 * viewx;
 				camy += 0.1 * viewy;
-				//move_key(0.1, 0.1, viewx, viewy);
-				if (collision(camx, camy))
+				//move_key(maze, 0.1, 0.1, viewx, viewy);
+				if (collision(maze, camx, camy))
 				{
 					camx -= 0.1 * viewx;
 					camy -= 0.1 * viewy;
-					move_key(-0.1, -0.1, viewx, viewy);
+					move_key(maze, -0.1, -0.1, viewx, viewy);
 				}
 			}
 			if (windowEvent.type == SDL_KEYDOWN && windowEvent.key.keysym.sym == SDLK_DOWN) { //If "down key" is pressed
 				camx -= 0.1 * viewx;
 				camy -= 0.1 * viewy;
-				//move_key(-0.1, -0.1, viewx, viewy);
-				if (collision(camx, camy))
+				//move_key(maze, -0.1, -0.1, viewx, viewy);
+				if (collision(maze, camx, camy))
 				{
 					camx += 0.1 * viewx;
 					camy += 0.1 * viewy;
-					move_key(0.1, 0.1, viewx, viewy);
+					move_key(maze, 0.1, 0.1, viewx, viewy);
 				}
 			}
 			if (windowEvent.type == SDL_KEYDOWN && windowEvent.key.keysym.sym == SDLK_SPACE) { //If "SPACE key" is pressed(jump)
@@ -414,20 +472,24 @@ int main(int argc, char* argv[]) {
 
 		glBindVertexArray(vao);
 		//drawGeometry(texturedShader, startVertTeapot, numVertsTeapot, startVertKnot, numVertsKnot);
-		drawWalls(texturedShader, startVertTeapot, numVertsTeapot);
-		drawFloors(texturedShader, startVertTeapot, numVertsTeapot);
-		for (int i = 0; i < player.doors.size(); i++)
+		if (maze.grid.tiles) // paged map: keep the tiles around us loaded
+		{
+			maze.grid.tiles->prefetch((int)camx, (int)camy, 2 * VIEW_CELLS);
+		}
+		drawWalls(texturedShader, startVertTeapot, numVertsTeapot, maze, camx, camy);
+		drawFloors(texturedShader, startVertTeapot, numVertsTeapot, maze, camx, camy);
+		for (size_t i = 0; i < maze.player.doors.size(); i++)
 		{
-			if (!player.doors[i].have_key)
+			if (!maze.player.doors[i].have_key && maze.player.doors[i].key != 0)
 			{
-				drawKey_Door(texturedShader, startVertKnot, numVertsKnot, player.doors[i].keyx, player.doors[i].keyy, player.doors[i].keyz, player.doors[i].r, player.doors[i].g, player.doors[i].b, true);
+				drawKey_Door(texturedShader, startVertKnot, numVertsKnot, maze.player.doors[i].keyx, maze.player.doors[i].keyy, maze.player.doors[i].keyz, maze.player.doors[i].r, maze.player.doors[i].g, maze.player.doors[i].b, true);
 			}
-			if (!player.doors[i].open)
+			if (!maze.player.doors[i].open && maze.player.doors[i].door != 0)
 			{
-				drawKey_Door(texturedShader, startVertTeapot, numVertsTeapot, (float)player.doors[i].doorx, (float)player.doors[i].doory, 0, player.doors[i].r, player.doors[i].g, player.doors[i].b, false);
+				drawKey_Door(texturedShader, startVertTeapot, numVertsTeapot, (float)maze.player.doors[i].doorx, (float)maze.player.doors[i].doory, 0, maze.player.doors[i].r, maze.player.doors[i].g, maze.player.doors[i].b, false);
 			}
 		}
-		drawGoal(texturedShader, startVertGoal, numVertsGoal);
+		drawGoal(texturedShader, startVertGoal, numVertsGoal, maze);
 		SDL_GL_SwapWindow(window); //Double buffering
 	}
 
@@ -502,7 +564,7 @@ void drawGeometry(int shaderProgram, int model1_start, int model1_numVerts, int
 	//Draw an instance of the model (at the position & orientation specified by the model matrix above)
 	glDrawArrays(GL_TRIANGLES, model2_start, model2_numVerts); //(Primitive Type, Start Vertex, Num Verticies)
 }
-void drawWalls(int shaderProgram, int model1_start, int model1_numVerts) {
+void drawWalls(int shaderProgram, int model1_start, int model1_numVerts, const MazeInstance& maze, float camx, float camy) {
 
 	GLint uniColor = glGetUniformLocation(shaderProgram, "inColor");
 	glm::vec3 colVec(colR, colG, colB);
@@ -516,10 +578,8 @@ void drawWalls(int shaderProgram, int model1_start, int model1_numVerts) {
 	//This model is stored in the VBO starting a offest model1_start and with model1_numVerts num. of verticies
 	//*************
 	
-	for (int i = 0; i < walls.size(); i++)
-	{
-		int x = walls[i].x;
-		int y = walls[i].y;
+	// one cube per set bit in the wall grid, then the ring of border walls around the map
+	auto drawWall = [&](int x, int y) {
 		//Translate the model (matrix) left and back
 		model = glm::mat4(1); //Load intentity
 		model = glm::translate(model, glm::vec3(x, y, 0));
@@ -530,6 +590,20 @@ void drawWalls(int shaderProgram, int model1_start, int model1_numVerts) {
 
 		//Draw an instance of the model (at the position & orientation specified by the model matrix above)
 		glDrawArrays(GL_TRIANGLES, model1_start, model1_numVerts); //(Primitive Type, Start Vertex, Num Verticies)
+	};
+	// only the walls that can be seen from the camera, big (or paged) maps cost the same
+	int x0 = (int)camx - VIEW_CELLS, x1 = (int)camx + VIEW_CELLS;
+	int y0 = (int)camy - VIEW_CELLS, y1 = (int)camy + VIEW_CELLS;
+	maze.grid.forEachWallIn(x0, y0, x1, y1, drawWall);
+	for (int i = max(x0, 0); i <= min(x1, maze.grid.width - 1); i++)
+	{
+		if (y0 <= -1) drawWall(i, -1);
+		if (y1 >= maze.grid.height) drawWall(i, maze.grid.height);
+	}
+	for (int i = max(y0, 0); i <= min(y1, maze.grid.height - 1); i++)
+	{
+		if (x0 <= -1) drawWall(-1, i);
+		if (x1 >= maze.grid.width) drawWall(maze.grid.width, i);
 	}
 }
 bool jump(float time,float &playerz)
@@ -544,7 +618,7 @@ bool jump(float time,float &playerz)
 	playerz = z;
 	return true;
 }
-void drawFloors(int shaderProgram, int model1_start, int model1_numVerts) {
+void drawFloors(int shaderProgram, int model1_start, int model1_numVerts, const MazeInstance& maze, float camx, float camy) {
 
 	GLint uniColor = glGetUniformLocation(shaderProgram, "inColor");
 	glm::vec3 colVec(colR, colG, colB);
@@ -557,9 +631,9 @@ void drawFloors(int shaderProgram, int model1_start, int model1_numVerts) {
 	//Draw model #1 the second time
 	//This model is stored in the VBO starting a offest model1_start and with model1_numVerts num. of verticies
 	//*************
-	for (int i = 0; i < width; i++)
+	for (int i = max((int)camx - VIEW_CELLS, 0); i < min((int)camx + VIEW_CELLS + 1, maze.width); i++)
 	{
-		for (int j = 0; j < height; j++)
+		for (int j = max((int)camy - VIEW_CELLS, 0); j < min((int)camy + VIEW_CELLS + 1, maze.height); j++)
 		{
 			//Translate the model (matrix) left and back
 			model = glm::mat4(1); //Load intentity
@@ -577,36 +651,7 @@ void drawFloors(int shaderProgram, int model1_start, int model1_numVerts) {
 
 
 }
-void move_key(float x, float y,float viewx, float viewy)
-{
-	float keypos = 0;
-	for (int i = 0; i < player.doors.size(); i++)
-	{
-		if (player.doors[i].have_key)
-		{
-			player.doors[i].keyx += x * viewx;
-			player.doors[i].keyy += y * viewy;
-			if (keypos == 1)
-			{
-				player.doors[i].keyz = 0.3;
-			}
-			else if (keypos == 2)
-			{
-				player.doors[i].keyz = -0.3;
-			}
-			else if (keypos == 3)
-			{
-				player.doors[i].keyz = 0.6;
-			}
-			else if (keypos == 4)
-			{
-				player.doors[i].keyz = -0.6;
-			}
-			keypos++;
-		}
-	}
-}
-void drawGoal(int shaderProgram, int model1_start, int model1_numVerts) {
+void drawGoal(int shaderProgram, int model1_start, int model1_numVerts, const MazeInstance& maze) {
 
 	GLint uniColor = glGetUniformLocation(shaderProgram, "inColor");
 	glm::vec3 colVec(colR, colG, colB);
@@ -622,7 +667,7 @@ void drawGoal(int shaderProgram, int model1_start, int model1_numVerts) {
 	
 	//Translate the model (matrix) left and back
 	model = glm::mat4(1); //Load intentity
-	model = glm::translate(model, glm::vec3(player.goalx,player.goaly ,0 ));
+	model = glm::translate(model, glm::vec3(maze.player.goalx,maze.player.goaly ,0 ));
 	glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(model));
 
 	//Set which texture to use (0 = wood texture ... bound to GL_TEXTURE0)
@@ -703,73 +748,6 @@ static char* readShaderSource(const char* shaderFile){
 	// return the string
 	return buffer;
 }
-// collision for door/key/wall
-bool collision(float x, float y)
-{ 
-	//check for wall
-	for (int i = 0; i < walls.size(); i++)
-	{
-		
-		if (fabs(x - walls[i].x) < 0.75 && fabs(y - walls[i].y) < 0.75) // collide with wall
-		{
-			return true;
-		}
-	}
-
-	// check for door
-	for (int i = 0; i < player.doors.size(); i++)
-	{
-		if (player.doors[i].open)
-		{
-			continue;
-		}
-		if (fabs(x - player.doors[i].doorx) < 1 && fabs(y - player.doors[i].doory) < 1) // collide with door
-		{
-			if (player.doors[i].have_key)
-			{
-				player.doors[i].open = true; // if have the key, open the door
-				return false;
-			}
-			else
-			{
-				return true;
-			}
-		}
-	}
-	
-	// check for key
-	
-	for (int i = 0; i < player.doors.size(); i++)
-	{
-		if (player.doors[i].have_key)
-		{
-			continue;
-		}
-		float dis = sqrt(pow(x - player.doors[i].keyx, 2) + pow(y - player.doors[i].keyy, 2));
-		if (dis < 0.5) // collide with key
-		{
-			player.doors[i].have_key = true;
-			//player.doors[i].keyx = player.Playerx + viewx;
-			//player.doors[i].keyy = player.Playery + viewy;
-			continue;
-		}
-	}
-	
-	// check for goal
-	float dis = sqrt(pow(x - player.goalx, 2) + pow(y - player.goaly, 2));
-	if (dis < 0.5) // reach the goal, reload the game
-	{
-		player.goal = true;
-		player.Playerx = player.startx;
-		player.Playery = player.starty;
-		for (int i = 0; i < player.doors.size(); i++)
-		{
-			player.doors[i].open = false;
-			player.doors[i].have_key = false;
-		}
-	}
-	return false;
-}
 // Create a GLSL program object from vertex and fragment shader files
 GLuint InitShader(const char* vShaderFileName, const char* fShaderFileName){
 	GLuint vertex_shader, fragment_shader;
@@ -0,0 +1,50 @@
+#pragma once
+#include <thread>
+#include <atomic>
+#include <vector>
+// tiny helper to spread independent jobs over all cores
+
+inline int parallelThreads()
+{
+	int threads = (int)std::thread::hardware_concurrency();
+	return threads > 0 ? threads : 1;
+}
+
+// runs fn(i) once for every i in [0, count). workers keep grabbing the next index
+// until there is none left, so uneven jobs still balance out.
+template <class Fn>
+void parallelFor(int count, Fn fn, int threads = 0)
+{
+	if (threads <= 0)
+	{
+		threads = parallelThreads();
+	}
+	if (threads > count)
+	{
+		threads = count;
+	}
+	if (threads <= 1)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			fn(i);
+		}
+		return;
+	}
+	std::atomic<int> next(0);
+	std::vector<std::thread> workers;
+	workers.reserve(threads);
+	for (int t = 0; t < threads; t++)
+	{
+		workers.push_back(std::thread([&]() {
+			for (int i = next++; i < count; i = next++)
+			{
+				fn(i);
+			}
+		}));
+	}
+	for (int t = 0; t < threads; t++)
+	{
+		workers[t].join();
+	}
+}
@@ -1,5 +1,4 @@
-
-
+#pragma once
 #include <stdio.h>
 #include <ctype.h>
 #include <cstdio>
@@ -7,19 +6,39 @@
 #include <fstream>
 #include <cstring>
 #include <vector>
-// so this parse file will obtain all info and seal into seperate class
+#include <unordered_map>
+#include "mapfile.h"
+#include "grid.h"
+#include "mapformat.h"
+#include "parallel.h"
+// so this parse file will obtain all info and seal into seperate class (a MazeInstance)
 // Players (contain start and goal, all doors and keys)
-// Walls
+// Walls (a bit per cell in the grid, see grid.h)
 using namespace std;
+// doors and keys are paired by a tag: the letters a-z / A-Z (except w, s and g which
+// are taken by walls, start and goal) are tags 0-25, and for levels that need more
+// pairs {n} is key n and [n] is door n, which is tag 26+n. either way it is one cell.
+const int LETTER_TAGS = 26;
+inline bool isKeyLetter(char c)
+{
+    return c >= 'a' && c <= 'z' && c != 'w' && c != 's' && c != 'g';
+}
+inline bool isDoorLetter(char c)
+{
+    return c >= 'A' && c <= 'Z' && c != 'W' && c != 'S' && c != 'G';
+}
 class Door {
 public:
-    char door;
-    char key;
+    int id;    // pairing tag, see above
+    char door; // the letter from the map, '[' for numbered doors, 0 until the door is found
+    char key;  // same for the key, '{' for numbered keys
     int doorx;
     int doory;
     float keyx;
     float keyy;
     float keyz;
+    int keyhomex; // where the map puts the key, keyx/keyy follow the player once it is picked up
+    int keyhomey;
 
     bool open;
     bool have_key;
@@ -28,16 +47,30 @@ public:
     float b;
     Door()
     {
+        id = -1;
+        door = 0;
+        key = 0;
+        doorx = doory = 0;
+        keyx = keyy = 0;
+        keyhomex = keyhomey = 0;
         have_key = false;
         open = false;
         keyz = 0;
-        r = (float)rand() / RAND_MAX;
-        g = (float)rand() / RAND_MAX;
-        b = (float)rand() / RAND_MAX;
+        colorFromTag();
+    }
+    // the colour of the door and its key, picked from the tag: the same pair is the same
+    // colour every time, and loading a map on another thread (mappack prefetch) doesn't
+    // share rand() with the game
+    void colorFromTag()
+    {
+        uint32_t h = ((uint32_t)id + 0x9e3779b9u) * 2654435761u;
+        h = (h ^ (h >> 15)) * 2246822519u;
+        h ^= h >> 13;
+        r = (float)(h & 0xff) / 255;
+        g = (float)((h >> 8) & 0xff) / 255;
+        b = (float)((h >> 16) & 0xff) / 255;
     }
 };
-int width = 5;
-int height = 5;
 class Player {
 public:
     int Playerx = 0;
@@ -48,162 +81,273 @@ public:
     int goaly = 0;
     bool goal = false;
     vector<Door> doors;
+    unordered_map<int, int> doorByTag; // tag -> index in doors
+    vector<int> carried;               // doors whose key we are holding
 };
-class Wall {
+class FlowField;
+// one maze: its grid, its doors and keys and the player walking it. there are no
+// globals, so a process can keep as many mazes as it likes and run them on any thread.
+class MazeInstance {
 public:
-    int x;
-    int y;
-    Wall(int x, int y)
+    int width = 5;
+    int height = 5;
+    Grid grid;
+    Player player;
+    std::shared_ptr<FlowField> flow; // distances to the goal (flowfield.h), NULL until built
+};
+// reads an int the same way "input >> value" does: skip blanks, optional sign, digits
+static bool readMapInt(const char*& p, const char* end, int& value)
+{
+    while (p < end && isspace((unsigned char)*p))
+        p++;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
     {
-        this->x = x;
-        this->y = y;
+        negative = (*p == '-');
+        p++;
     }
-};
-
-vector<Wall> walls;
-Player player;
-void parseMapFile(std::string fileName){
-  //TODO: Override the default values with new data from the file "fileName"
-    // open the file containing the scene description
-    std::ifstream input(fileName.c_str());
-    // check for errors in opening the file
-    if (input.fail()) {
-        std::cout << "Can't open file '" << fileName << "'" << std::endl;
-        return;
+    if (p == end || !isdigit((unsigned char)*p))
+        return false;
+    int result = 0;
+    while (p < end && isdigit((unsigned char)*p))
+    {
+        result = result * 10 + (*p - '0');
+        p++;
     }
-
-    // determine the file size (this is optional -- feel free to delete the 6 lines below)
-    std::streampos begin, end;
-    begin = input.tellg();
-    input.seekg(0, std::ios::end);
-    end = input.tellg();
-    std::cout << "File '" << fileName << "' is: " << (end - begin) << " bytes long.\n\n";
-    input.seekg(0, std::ios::beg);
-
-
-    //Loop through reading each line
-    input >> width >> height;
-    std::string line;
-    int ycor = height-1;
+    value = negative ? -result : result;
+    return true;
+}
+// finds (or starts) the door/key pair for a tag with one hash lookup
+void pairMapTag(MazeInstance& maze, int tag, bool isKey, char letter, int xcor, int ycor)
+{
+    int index;
+    unordered_map<int, int>::iterator it = maze.player.doorByTag.find(tag);
+    if (it == maze.player.doorByTag.end()) // create a new pair
+    {
+        index = (int)maze.player.doors.size();
+        maze.player.doors.push_back(Door());
+        maze.player.doors[index].id = tag;
+        maze.player.doors[index].colorFromTag();
+        maze.player.doorByTag[tag] = index;
+    }
+    else
+    {
+        index = it->second;
+    }
+    Door& pair = maze.player.doors[index];
+    if (isKey)
+    {
+        if (pair.key != 0) // the same key twice, the last one wins
+            maze.grid.entities.erase(maze.grid.cellKey(pair.keyhomex, pair.keyhomey));
+        pair.key = letter;
+        pair.keyx = pair.keyhomex = xcor;
+        pair.keyy = pair.keyhomey = ycor;
+        maze.grid.setEntity(xcor, ycor, CELL_KEY, index);
+    }
+    else
+    {
+        if (pair.door != 0)
+            maze.grid.entities.erase(maze.grid.cellKey(pair.doorx, pair.doory));
+        pair.door = letter;
+        pair.doorx = xcor;
+        pair.doory = ycor;
+        maze.grid.setEntity(xcor, ycor, CELL_DOOR, index);
+    }
+}
+// everything that is not floor or wall: start, goal, keys and doors.
+// tag is the number inside {n} / [n], -1 for everything else
+void addMapCell(MazeInstance& maze, char c, int xcor, int ycor, int tag)
+{
+    if (c == 'G') // Goal
+    {
+        maze.player.goalx = xcor;
+        maze.player.goaly = ycor;
+        maze.grid.setEntity(xcor, ycor, CELL_GOAL);
+    }
+    else if (c == 'S') //Start
+    {
+        maze.player.Playerx = xcor;
+        maze.player.Playery = ycor;
+        maze.player.startx = xcor;
+        maze.player.starty = ycor;
+        maze.grid.setEntity(xcor, ycor, CELL_START);
+    }
+    else if (isKeyLetter(c)) // key
+    {
+        pairMapTag(maze, c - 'a', true, c, xcor, ycor);
+    }
+    else if (isDoorLetter(c)) // door
+    {
+        pairMapTag(maze, c - 'A', false, c, xcor, ycor);
+    }
+    else if ((c == '{' || c == '[') && tag >= 0) // numbered key / door
+    {
+        pairMapTag(maze, LETTER_TAGS + tag, c == '{', c, xcor, ycor);
+    }
+    else {
+        std::cout << "Unknown char " << c << std::endl;
+    }
+}
+// reads the n of {n} or [n], p is on the bracket and is left on the closing one.
+// returns -1 (and leaves p alone) if the tag is broken
+static int readMapTag(const char*& p, const char* end)
+{
+    char close = (*p == '{') ? '}' : ']';
+    const char* q = p + 1;
+    int tag = 0;
+    int digits = 0;
+    while (q < end && isdigit((unsigned char)*q) && digits < 9)
+    {
+        tag = tag * 10 + (*q - '0');
+        digits++;
+        q++;
+    }
+    if (digits == 0 || q == end || *q != close)
+        return -1;
+    p = q;
+    return tag;
+}
+// walks map rows from p to end, the first word found is row ycor and every word
+// after it is one row further down. every character of a word is one cell.
+// a numbered key/door ({n} or [n]) is several characters but still one cell.
+// the entities are handed to addCell in file order.
+template <class AddCell>
+void parseMapRows(MazeInstance& maze, const char* p, const char* end, int ycor, AddCell addCell)
+{
     int xcor = -1;
-    while (input >> line) { //Read first word in the line (i.e., the command type)
+    while (p < end)
+    {
+        while (p < end && isspace((unsigned char)*p))
+            p++;
+        if (p == end)
+            break;
         xcor = -1;
-        while (line != "")
+        for (; p < end && !isspace((unsigned char)*p); p++)
         {
             xcor++;
-            if (line[0] == '0') { // nothing
-                line = line.substr(1);
-                continue;
-            }
-            else if (line[0] == 'W') // wall
-            {
-                Wall newWall(xcor, ycor);
-                walls.push_back(newWall);
-                line = line.substr(1);
+            char c = *p;
+            int tag = -1;
+            if (c == '{' || c == '[')
+                tag = readMapTag(p, end);
+            if (!maze.grid.inside(xcor, ycor)) { // past the size given in the header
                 continue;
             }
-            else if (line[0] == 'G') // Goal
-            {
-                player.goalx = xcor;
-                player.goaly = ycor;
-                line = line.substr(1);
-                continue;
-            }
-            else if (line[0] == 'S') //Start
-            {
-                player.Playerx = xcor;
-                player.Playery = ycor;
-                player.startx = xcor;
-                player.starty = ycor;
-                line = line.substr(1);
+            if (c == '0') { // nothing
                 continue;
             }
-            else if (line[0] == 'a' || line[0] == 'b'|| line[0] == 'c'|| line[0] == 'd'|| line[0] == 'e') // key
+            else if (c == 'W') // wall
             {
-                char keyletter = line[0];
-                bool find = false;
-                for (int i = 0; i < player.doors.size(); i++) // find existing door
-                {
-                    if (player.doors[i].door == toupper(keyletter))
-                    {
-                        find = true;
-                        player.doors[i].key = keyletter;
-                        player.doors[i].keyx = xcor;
-                        player.doors[i].keyy = ycor;
-                    }
-                }
-                if (!find) // create a new pair
-                {
-                    Door newdoor;
-                    newdoor.keyx = xcor;
-                    newdoor.keyy = ycor;
-                    newdoor.key = keyletter;
-                    player.doors.push_back(newdoor);
-                }
-                line = line.substr(1);
-                continue;
+                maze.grid.setWall(xcor, ycor, true);
             }
-            else if (line[0] == 'A' || line[0] == 'B' || line[0] == 'C' || line[0] == 'D' || line[0] == 'E') // door
+            else
             {
-                char doorletter = line[0];
-                bool find = false;
-                for (int i = 0; i < player.doors.size(); i++) // find existing key
-                {
-                    if (player.doors[i].key == tolower(doorletter))
-                    {
-                        find = true;
-                        player.doors[i].door = doorletter;
-                        player.doors[i].doorx = xcor;
-                        player.doors[i].doory = ycor;
-                    }
-                }
-                if (!find) // create a new pair
-                {
-                    Door newdoor;
-                    newdoor.doorx = xcor;
-                    newdoor.doory = ycor;
-                    newdoor.door = doorletter;
-                    player.doors.push_back(newdoor);
-                }
-                line = line.substr(1);
-                continue;
+                addCell(c, xcor, ycor, tag);
             }
-            else {
-                std::cout << "Unknown char " << line[0] << std::endl;
-                line = line.substr(1);
-                continue;
-                
-            }
-            
         }
         ycor--;
     }
+}
+// big maps are parsed on all cores (see parseMapBufferParallel)
+size_t parallelParseBytes = 16 << 20;
+int parseThreads = 0; // 0 = one per core
 
-
-    // these two are the walls around the map
-    for (int i = 0; i < width; i++)
+// splits the rows between threads. rows only depend on each other through the
+// door/key pairing, so every worker fills its own rows of the grid and keeps the
+// special cells it finds in a local list. the lists are replayed in file order at
+// the end, which pairs doors and keys exactly like the single threaded parse.
+void parseMapBufferParallel(MazeInstance& maze, const char* p, const char* end, int threads)
+{
+    if (threads <= 0)
+        threads = parallelThreads();
+    // cut at word boundaries so no row is split between two workers
+    std::vector<const char*> cuts(threads + 1);
+    cuts[0] = p;
+    cuts[threads] = end;
+    for (int i = 1; i < threads; i++)
+    {
+        const char* cut = p + (end - p) / threads * i;
+        if (cut < cuts[i - 1])
+            cut = cuts[i - 1];
+        while (cut < end && !isspace((unsigned char)*cut))
+            cut++;
+        cuts[i] = cut;
+    }
+    // pass 1: how many rows are in each piece, so every worker knows its first row
+    std::vector<int> rows(threads, 0);
+    parallelFor(threads, [&](int i) {
+        bool inWord = false;
+        for (const char* q = cuts[i]; q < cuts[i + 1]; q++)
+        {
+            bool space = isspace((unsigned char)*q) != 0;
+            if (!space && !inWord)
+                rows[i]++;
+            inWord = !space;
+        }
+    }, threads);
+    std::vector<int> firstRow(threads);
+    int ycor = maze.height - 1;
+    for (int i = 0; i < threads; i++)
     {
-        Wall newWall(i, -1);
-        walls.push_back(newWall);
-        Wall newWalls(i, width);
-        walls.push_back(newWalls);
+        firstRow[i] = ycor;
+        ycor -= rows[i];
     }
-    for (int i = 0; i < height; i++)
+    // pass 2: fill the grid, every row is whole 64-bit words so workers never share a word
+    struct FoundCell { char c; int x; int y; int tag; };
+    std::vector<std::vector<FoundCell> > found(threads);
+    parallelFor(threads, [&](int i) {
+        parseMapRows(maze, cuts[i], cuts[i + 1], firstRow[i], [&](char c, int x, int y, int tag) {
+            FoundCell cell = { c, x, y, tag };
+            found[i].push_back(cell);
+        });
+    }, threads);
+    // reduce: pair up doors and keys in file order (a hash lookup each)
+    for (int i = 0; i < threads; i++)
     {
-        Wall newWall(-1, i);
-        walls.push_back(newWall);
-        Wall newWalls(height,i);
-        walls.push_back(newWalls);
+        for (size_t j = 0; j < found[i].size(); j++)
+        {
+            addMapCell(maze, found[i][j].c, found[i][j].x, found[i][j].y, found[i][j].tag);
+        }
+    }
+}
+// parses a whole map file that is already in memory
+void parseMapBuffer(MazeInstance& maze, const char* data, size_t size)
+{
+    const char* p = data;
+    const char* end = data + size;
+    if (!readMapInt(p, end, maze.width) || !readMapInt(p, end, maze.height))
+        p = end; // like a failed stream read: no rows, keep the default size
+    maze.grid.resize(maze.width, maze.height);
+    int threads = parseThreads > 0 ? parseThreads : parallelThreads();
+    if ((size_t)(end - p) >= parallelParseBytes && threads > 1)
+        parseMapBufferParallel(maze, p, end, threads);
+    else
+        parseMapRows(maze, p, end, maze.height - 1, [&](char c, int x, int y, int tag) { addMapCell(maze, c, x, y, tag); });
+
+    // no border walls to add: the grid treats everything outside the map as wall
+}
+bool loadMapBinary(MazeInstance& maze, std::shared_ptr<MappedFile> input, std::string fileName);
+void parseMapFile(MazeInstance& maze, std::string fileName){
+    // map the whole file and parse it in place, no stream and no per-row copies
+    std::shared_ptr<MappedFile> input(new MappedFile());
+    // check for errors in opening the file
+    if (!input->open(fileName)) {
+        std::cout << "Can't open file '" << fileName << "'" << std::endl;
+        return;
+    }
+    std::cout << "File '" << fileName << "' is: " << input->size() << " bytes long.\n\n";
+    if (isMapBinary(input->data(), input->size())) { // made by map2bin, nothing to parse
+        loadMapBinary(maze, input, fileName);
+        return;
     }
+    parseMapBuffer(maze, input->data(), input->size());
 }
 /*
 int main(int argc, char* argv[])
 {
-    parseMapFile(argv[1]);
-    for (int i = 0; i < walls.size(); i++)
-    {
-        cout << "wall " << walls[i].x << " " << walls[i].y << endl;
-    }
+    MazeInstance maze;
+    parseMapFile(maze, argv[1]);
+    Player& player = maze.player;
+    maze.grid.forEachWall([](int x, int y) { cout << "wall " << x << " " << y << endl; });
     cout << "player " << player.Playerx << " " << player.Playery << endl;
     cout << "goal " << player.goalx << " " << player.goaly << endl;
     for (int i = 0; i < player.doors.size(); i++)
@@ -214,4 +358,5 @@ int main(int argc, char* argv[])
     return 0;
 }
 #endif
-*/
\ No newline at end of file
+*/
+#include "mapbin.h"
@@ -0,0 +1,279 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <queue>
+#include <vector>
+#include <utility>
+#include "parse.h"
+// point to point paths over the map grid for NPCs: Jump Point Search, and plain A* to
+// check it against. moves are the 8 directions, a diagonal one only when both cells
+// beside it are open too (no cutting corners), straight steps cost 1 and diagonal
+// ones sqrt 2. walls, the border and closed doors block, doors are looked at again on
+// every query so one that opens counts straight away.
+// JPS runs along straight lines and diagonals without putting anything on the open
+// list until it hits a cell with a forced neighbour (a way that only opens up there)
+// or the goal, so long corridors cost a scan of a few bit reads instead of a heap
+// push per cell. a JPS path is its jump points, expandPath fills in the cells between.
+// a PathFinder keeps its node arrays between queries (12 bytes a cell, made on the
+// first query on a map of that size), one per thread.
+class PathFinder {
+public:
+	size_t expanded = 0; // nodes taken off the open list by the last query
+	float cost = 0;      // length of the last path found
+
+	// JPS from (sx, sy) to (gx, gy). path gets the jump points, both ends included.
+	// false if there is no way
+	bool jps(const MazeInstance& maze, int sx, int sy, int gx, int gy, std::vector<std::pair<int, int> >& path)
+	{
+		return search(maze, sx, sy, gx, gy, path, true);
+	}
+	// A* over single steps, path gets every cell
+	bool astar(const MazeInstance& maze, int sx, int sy, int gx, int gy, std::vector<std::pair<int, int> >& path)
+	{
+		return search(maze, sx, sy, gx, gy, path, false);
+	}
+	// every cell along a path of jump points (each leg is a straight line or a diagonal)
+	static void expandPath(const std::vector<std::pair<int, int> >& points, std::vector<std::pair<int, int> >& cells)
+	{
+		cells.clear();
+		for (size_t i = 0; i < points.size(); i++)
+		{
+			if (i == 0)
+			{
+				cells.push_back(points[0]);
+				continue;
+			}
+			int x = points[i - 1].first, y = points[i - 1].second;
+			int dx = sign(points[i].first - x), dy = sign(points[i].second - y);
+			while (x != points[i].first || y != points[i].second)
+			{
+				x += dx;
+				y += dy;
+				cells.push_back(std::make_pair(x, y));
+			}
+		}
+	}
+private:
+	const Grid* grid = NULL;
+	int width = 0;
+	int height = 0;
+	uint32_t query = 0;
+	std::vector<uint32_t> stamp;   // 2 * query when a node is open, 2 * query + 1 once closed
+	std::vector<float> g;
+	std::vector<uint32_t> parent;
+	std::vector<uint64_t> closedDoors; // one bit a cell
+	std::vector<size_t> doorCells;     // the bits set in closedDoors
+	typedef std::pair<float, uint32_t> OpenNode;
+	std::priority_queue<OpenNode, std::vector<OpenNode>, std::greater<OpenNode> > open;
+
+	static int sign(int v)
+	{
+		return (v > 0) - (v < 0);
+	}
+	bool walkable(int x, int y) const
+	{
+		if (x < 0 || y < 0 || x >= width || y >= height)
+			return false;
+		size_t c = (size_t)y * width + x;
+		if ((closedDoors[c >> 6] >> (c & 63)) & 1)
+			return false;
+		return grid->wordsPerRow > 0 ? !((grid->row(y)[x >> 6] >> (x & 63)) & 1) : !grid->isWall(x, y);
+	}
+	static float octile(int dx, int dy)
+	{
+		dx = abs(dx);
+		dy = abs(dy);
+		return dx < dy ? (float)(dy - dx) + 1.41421356f * dx : (float)(dx - dy) + 1.41421356f * dy;
+	}
+	void prepare(const MazeInstance& maze)
+	{
+		grid = &maze.grid;
+		if (maze.grid.width != width || maze.grid.height != height)
+		{
+			width = maze.grid.width;
+			height = maze.grid.height;
+			size_t cells = (size_t)width * height;
+			stamp.assign(cells, 0);
+			g.assign(cells, 0);
+			parent.assign(cells, 0);
+			closedDoors.assign((cells + 63) / 64, 0);
+			doorCells.clear();
+			query = 0;
+		}
+		if (++query >= 0x7fffffff) // stamps run out, start again
+		{
+			std::fill(stamp.begin(), stamp.end(), 0);
+			query = 1;
+		}
+		for (size_t i = 0; i < doorCells.size(); i++)
+			closedDoors[doorCells[i] >> 6] = 0;
+		doorCells.clear();
+		for (size_t i = 0; i < maze.player.doors.size(); i++)
+		{
+			const Door& door = maze.player.doors[i];
+			if (door.door != 0 && !door.open && maze.grid.inside(door.doorx, door.doory))
+			{
+				size_t c = (size_t)door.doory * width + door.doorx;
+				closedDoors[c >> 6] |= (uint64_t)1 << (c & 63);
+				doorCells.push_back(c);
+			}
+		}
+		open = std::priority_queue<OpenNode, std::vector<OpenNode>, std::greater<OpenNode> >();
+	}
+	// the first jump point going (dx, dy) from (x, y), (x, y) itself not counted.
+	// -1 if the line runs into a wall first
+	int64_t jump(int x, int y, int dx, int dy, int gx, int gy) const
+	{
+		while (true)
+		{
+			if (dx != 0 && dy != 0 && !(walkable(x + dx, y) && walkable(x, y + dy))) // corner
+				return -1;
+			x += dx;
+			y += dy;
+			if (!walkable(x, y))
+				return -1;
+			if (x == gx && y == gy)
+				return (int64_t)y * width + x;
+			if (dx != 0 && dy != 0)
+			{
+				// a diagonal stops where one of its straight lines finds something
+				if (jump(x, y, dx, 0, gx, gy) >= 0 || jump(x, y, 0, dy, gx, gy) >= 0)
+					return (int64_t)y * width + x;
+			}
+			else if (dx != 0)
+			{
+				if ((walkable(x, y - 1) && !walkable(x - dx, y - 1)) || (walkable(x, y + 1) && !walkable(x - dx, y + 1)))
+					return (int64_t)y * width + x;
+			}
+			else
+			{
+				if ((walkable(x - 1, y) && !walkable(x - 1, y - dy)) || (walkable(x + 1, y) && !walkable(x + 1, y - dy)))
+					return (int64_t)y * width + x;
+			}
+		}
+	}
+	// the directions worth going on in from (x, y) having come in going (dx, dy), all 8
+	// (less the blocked ones) at the start
+	int directions(int x, int y, int dx, int dy, int (*dirs)[2]) const
+	{
+		int n = 0;
+		auto add = [&](int ddx, int ddy) {
+			dirs[n][0] = ddx;
+			dirs[n][1] = ddy;
+			n++;
+		};
+		if (dx == 0 && dy == 0)
+		{
+			for (int ddy = -1; ddy <= 1; ddy++)
+				for (int ddx = -1; ddx <= 1; ddx++)
+					if ((ddx != 0 || ddy != 0) && walkable(x + ddx, y + ddy) && (ddx == 0 || ddy == 0 || (walkable(x + ddx, y) && walkable(x, y + ddy))))
+						add(ddx, ddy);
+			return n;
+		}
+		if (dx != 0 && dy != 0)
+		{
+			bool side = walkable(x + dx, y), up = walkable(x, y + dy);
+			if (up)
+				add(0, dy);
+			if (side)
+				add(dx, 0);
+			if (side && up)
+				add(dx, dy);
+		}
+		else if (dx != 0)
+		{
+			bool ahead = walkable(x + dx, y), top = walkable(x, y + 1), bottom = walkable(x, y - 1);
+			if (ahead)
+			{
+				add(dx, 0);
+				if (top)
+					add(dx, 1);
+				if (bottom)
+					add(dx, -1);
+			}
+			if (top)
+				add(0, 1);
+			if (bottom)
+				add(0, -1);
+		}
+		else
+		{
+			bool ahead = walkable(x, y + dy), right = walkable(x + 1, y), left = walkable(x - 1, y);
+			if (ahead)
+			{
+				add(0, dy);
+				if (right)
+					add(1, dy);
+				if (left)
+					add(-1, dy);
+			}
+			if (right)
+				add(1, 0);
+			if (left)
+				add(-1, 0);
+		}
+		return n;
+	}
+	bool search(const MazeInstance& maze, int sx, int sy, int gx, int gy, std::vector<std::pair<int, int> >& path, bool jumps)
+	{
+		prepare(maze);
+		path.clear();
+		expanded = 0;
+		cost = 0;
+		if (!walkable(sx, sy) || !walkable(gx, gy))
+			return false;
+		uint32_t start = (uint32_t)((size_t)sy * width + sx), goal = (uint32_t)((size_t)gy * width + gx);
+		uint32_t isOpen = 2 * query, isClosed = 2 * query + 1;
+		stamp[start] = isOpen;
+		g[start] = 0;
+		parent[start] = start;
+		open.push(OpenNode(octile(gx - sx, gy - sy), start));
+		while (!open.empty())
+		{
+			uint32_t c = open.top().second;
+			open.pop();
+			if (stamp[c] == isClosed) // an older copy of a node that got cheaper
+				continue;
+			stamp[c] = isClosed;
+			expanded++;
+			if (c == goal)
+				break;
+			int x = (int)(c % width), y = (int)(c / width);
+			int px = (int)(parent[c] % width), py = (int)(parent[c] / width);
+			int dirs[8][2];
+			int n = jumps ? directions(x, y, sign(x - px), sign(y - py), dirs) : directions(x, y, 0, 0, dirs);
+			for (int i = 0; i < n; i++)
+			{
+				int64_t next;
+				if (jumps)
+					next = jump(x, y, dirs[i][0], dirs[i][1], gx, gy);
+				else
+					next = (int64_t)(y + dirs[i][1]) * width + x + dirs[i][0];
+				if (next < 0)
+					continue;
+				uint32_t nc = (uint32_t)next;
+				int nx = (int)(nc % width), ny = (int)(nc / width);
+				float ng = g[c] + octile(nx - x, ny - y);
+				if (stamp[nc] == isClosed || (stamp[nc] == isOpen && g[nc] <= ng))
+					continue;
+				stamp[nc] = isOpen;
+				g[nc] = ng;
+				parent[nc] = c;
+				open.push(OpenNode(ng + octile(gx - nx, gy - ny), nc));
+			}
+		}
+		if (stamp[goal] != isClosed)
+			return false;
+		cost = g[goal];
+		for (uint32_t c = goal; ; c = parent[c])
+		{
+			path.push_back(std::make_pair((int)(c % width), (int)(c / width)));
+			if (c == start)
+				break;
+		}
+		std::reverse(path.begin(), path.end());
+		return true;
+	}
+};
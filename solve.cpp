@@ -0,0 +1,76 @@
+// Checks that a map (text, binary or tiled) can be finished and how short the best run
+// is, keys and doors included (solver.h). exits 1 if the goal can't be reached on any
+// of them, so it can check a folder of generated levels.
+// -a uses A* instead of BFS, -p prints the way as x y lines. -b only checks that the
+// goal can be reached, with the bit flood (bitflood.h), fast enough for whole folders.
+// maps with more door/key pairs than the solver has bits for (MAX_KEY_PAIRS) get the
+// bit flood check too.
+//
+//Linux build: g++ -O2 solve.cpp -o solve -pthread
+//usage:       ./solve [-a] [-p] [-b] map.txt [map.txt ...]
+
+#include <chrono>
+#include "solver.h"
+#include "bitflood.h"
+
+int main(int argc, char* argv[])
+{
+	SolveMethod method = SOLVE_BFS;
+	bool printPath = false;
+	bool quick = false;
+	std::vector<const char*> fileNames;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-a") == 0)
+			method = SOLVE_ASTAR;
+		else if (strcmp(argv[i], "-p") == 0)
+			printPath = true;
+		else if (strcmp(argv[i], "-b") == 0)
+			quick = true;
+		else
+			fileNames.push_back(argv[i]);
+	}
+	if (fileNames.empty())
+	{
+		printf("usage: %s [-a] [-p] [-b] <map> [<map> ...]\n", argv[0]);
+		return 1;
+	}
+	int failed = 0;
+	for (size_t f = 0; f < fileNames.size(); f++)
+	{
+		const char* fileName = fileNames[f];
+		MazeInstance maze;
+		parseMapFile(maze, fileName);
+		int pairs = 0;
+		for (size_t i = 0; i < maze.player.doors.size(); i++)
+			if (maze.player.doors[i].door != 0 && maze.player.doors[i].key != 0)
+				pairs++;
+		if (pairs > MAX_SOLVE_KEYS && !quick)
+			printf("%s: %d door/key pairs, more than the solver takes (%d), only checking the goal can be reached\n", fileName, pairs, MAX_SOLVE_KEYS);
+		if (quick || pairs > MAX_SOLVE_KEYS)
+		{
+			auto begin = std::chrono::steady_clock::now();
+			bool solvable = bitFloodSolvable(maze);
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+			printf("%s: %s (%.2f ms)\n", fileName, solvable ? "solvable" : "no way to the goal", seconds * 1e3);
+			failed += solvable ? 0 : 1;
+			continue;
+		}
+		MazeSolution solution;
+		auto begin = std::chrono::steady_clock::now();
+		bool solved = solveMaze(maze, solution, method, printPath);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+		if (!solved)
+		{
+			printf("%s: no way to the goal (%zu states, %.1f ms)\n", fileName, solution.states, seconds * 1e3);
+			failed++;
+			continue;
+		}
+		printf("%s: %d steps (%zu states, %.1f ms)\n", fileName, solution.steps, solution.states, seconds * 1e3);
+		for (size_t i = 0; i < solution.path.size(); i++)
+		{
+			printf("%d %d\n", solution.path[i].first, solution.path[i].second);
+		}
+	}
+	return failed > 0 ? 1 : 0;
+}
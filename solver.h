@@ -0,0 +1,218 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <utility>
+#include "parse.h"
+// finds the shortest way from a cell to the goal with doors and keys taken into
+// account, on the MazeInstance parseMapFile gives. a state is a cell plus the keys held
+// so far (one bit per door that has a key, picked up by walking onto it, kept for
+// good), a door can be walked through when its bit is held. doors without a key are
+// walls, keys without a door don't matter.
+// BFS or A* (manhattan distance, costs are all 1 so f only ever goes up by 0 or 2 and
+// two buckets are enough). visited states are one bit each, a bitset per key mask made
+// the first time that mask is reached, so only the masks actually held cost memory.
+// moves are the 4 grid directions, steps is the number of moves.
+enum SolveMethod { SOLVE_BFS = 0, SOLVE_ASTAR };
+
+const int MAX_SOLVE_KEYS = MAX_KEY_PAIRS; // 2^20 masks is already far past what fits in memory
+
+class MazeSolution {
+public:
+	bool solvable = false;
+	int steps = -1;
+	size_t states = 0; // states taken off the queue
+	std::vector<std::pair<int, int> > path; // from the first cell to the goal, when asked for
+};
+
+const int solveStepX[4] = { 0, 0, -1, 1 }; // up, down, left, right
+const int solveStepY[4] = { 1, -1, 0, 0 };
+
+// from (fromx, fromy). carried starts with the keys the player holds now instead of none
+bool solveMazeFrom(const MazeInstance& maze, MazeSolution& solution, int fromx, int fromy, bool carried = false,
+	SolveMethod method = SOLVE_BFS, bool wantPath = false)
+{
+	solution = MazeSolution();
+	const Grid& grid = maze.grid;
+	const std::vector<Door>& doors = maze.player.doors;
+	if (!grid.inside(fromx, fromy) || grid.isWall(fromx, fromy))
+	{
+		return false;
+	}
+	// a bit for every door with a key, and a bitset of the cells where something happens
+	// so the entity table is only looked at there
+	std::vector<int> keyBit(doors.size(), -1);
+	int keyCount = 0;
+	uint32_t startMask = 0;
+	for (size_t i = 0; i < doors.size(); i++)
+	{
+		if (doors[i].door != 0 && doors[i].key != 0)
+		{
+			if (keyCount == MAX_SOLVE_KEYS)
+			{
+				std::cout << "Too many keys to solve (" << MAX_SOLVE_KEYS << " at most)" << std::endl;
+				return false;
+			}
+			if (carried && doors[i].have_key)
+				startMask |= 1u << keyCount;
+			keyBit[i] = keyCount++;
+		}
+	}
+	uint64_t cells = (uint64_t)grid.width * grid.height;
+	std::vector<uint64_t> special((cells + 63) / 64, 0);
+	for (std::unordered_map<uint64_t, Entity>::const_iterator it = grid.entities.begin(); it != grid.entities.end(); ++it)
+	{
+		if (it->second.type == CELL_DOOR || it->second.type == CELL_KEY)
+			special[it->first >> 6] |= (uint64_t)1 << (it->first & 63);
+	}
+	// what a cell does to mask m: -1 can't go in, otherwise the mask after stepping on it.
+	// in-memory walls are read straight from the words, no Grid call per cell
+	const uint64_t* walls = grid.wordsPerRow > 0 ? grid.words() : NULL;
+	size_t wordsPerRow = grid.wordsPerRow;
+	auto enter = [&](int x, int y, uint64_t c, uint32_t m) -> int64_t {
+		if (walls != NULL ? (walls[(size_t)y * wordsPerRow + (x >> 6)] >> (x & 63)) & 1 : grid.isWall(x, y))
+			return -1;
+		if (!((special[c >> 6] >> (c & 63)) & 1))
+			return m;
+		const Entity* e = grid.entity(x, y);
+		int bit = keyBit[e->index];
+		if (e->type == CELL_DOOR)
+			return bit >= 0 && (m >> bit) & 1 ? (int64_t)m : -1;
+		return bit >= 0 ? (int64_t)(m | (1u << bit)) : (int64_t)m;
+	};
+
+	// queue entries: cell in bits 0-39, mask in 40-59, the way in in 60-63
+	// (0 for the first cell, 1 + direction, 8 set when a key was picked up on arrival).
+	// the cell is y << shift | x, rows padded to a power of two so taking it apart is a
+	// mask and a shift instead of a divide per state
+	int shift = 0;
+	while (((int64_t)1 << shift) < grid.width)
+		shift++;
+	if (((uint64_t)grid.height << shift) > ((uint64_t)1 << 40))
+	{
+		std::cout << "Map too big to solve (" << grid.width << " x " << grid.height << ")" << std::endl;
+		return false;
+	}
+	uint64_t xMask = ((uint64_t)1 << shift) - 1;
+	// a visited bitset per mask, made the first time the mask is reached. closedBits
+	// points into them so a lookup is one load and no checks on the vector
+	std::vector<std::vector<uint64_t> > closed((size_t)1 << keyCount);
+	std::vector<uint64_t*> closedBits(closed.size(), NULL);
+	std::vector<std::vector<uint8_t> > ways(wantPath ? closed.size() : 0);
+	auto isClosed = [&](uint64_t c, uint32_t m) {
+		return closedBits[m] != NULL && ((closedBits[m][c >> 6] >> (c & 63)) & 1);
+	};
+	auto close = [&](uint64_t c, uint32_t m, int way) {
+		if (closedBits[m] == NULL)
+		{
+			closed[m].assign((cells + 63) / 64, 0);
+			closedBits[m] = closed[m].data();
+			if (wantPath)
+				ways[m].assign(cells, 0);
+		}
+		closedBits[m][c >> 6] |= (uint64_t)1 << (c & 63);
+		if (wantPath)
+			ways[m][c] = (uint8_t)way;
+	};
+	bool astar = method == SOLVE_ASTAR;
+	int goalx = maze.player.goalx, goaly = maze.player.goaly;
+	auto h = [&](int x, int y) {
+		return astar ? abs(x - goalx) + abs(y - goaly) : 0;
+	};
+
+	uint64_t from = grid.cellKey(fromx, fromy);
+	int64_t first = enter(fromx, fromy, from, startMask);
+	if (first < 0) // standing in a locked door
+	{
+		return false;
+	}
+	std::vector<uint64_t> now, later; // f and the one after it
+	now.push_back(((uint64_t)fromy << shift | fromx) | (uint64_t)first << 40);
+	if (!astar)
+		close(from, (uint32_t)first, 0);
+	int f = h(fromx, fromy);
+	uint32_t width = (uint32_t)grid.width, height = (uint32_t)grid.height;
+	uint64_t goalCell = 0;
+	uint32_t goalMask = 0;
+	while (!now.empty() && !solution.solvable)
+	{
+		while (!now.empty())
+		{
+			uint64_t entry = now.back();
+			now.pop_back();
+			uint64_t cell = entry & (((uint64_t)1 << 40) - 1);
+			int x = (int)(cell & xMask), y = (int)(cell >> shift);
+			uint64_t c = (uint64_t)y * width + x;
+			uint32_t m = (uint32_t)(entry >> 40) & ((1u << MAX_SOLVE_KEYS) - 1);
+			if (astar) // closed when taken off, there can be copies
+			{
+				if (isClosed(c, m))
+					continue;
+				close(c, m, (int)(entry >> 60));
+			}
+			solution.states++;
+			if (x == goalx && y == goaly)
+			{
+				solution.solvable = true;
+				goalCell = c;
+				goalMask = m;
+				break;
+			}
+			int here = astar ? h(x, y) : 0;
+			for (int d = 0; d < 4; d++)
+			{
+				int nx = x + solveStepX[d], ny = y + solveStepY[d];
+				if ((uint32_t)nx >= width || (uint32_t)ny >= height) // -1 wraps too
+					continue;
+				uint64_t nc = c + (int64_t)solveStepY[d] * width + solveStepX[d];
+				int64_t nm = enter(nx, ny, nc, m);
+				if (nm < 0 || isClosed(nc, (uint32_t)nm))
+					continue;
+				int way = (d + 1) | (nm != m ? 8 : 0);
+				if (!astar)
+					close(nc, (uint32_t)nm, way);
+				uint64_t next = ((uint64_t)ny << shift | nx) | (uint64_t)nm << 40 | (uint64_t)way << 60;
+				if (astar && h(nx, ny) < here) // f stays the same
+					now.push_back(next);
+				else
+					later.push_back(next);
+			}
+		}
+		if (!solution.solvable)
+		{
+			now.swap(later);
+			f += astar ? 2 : 1;
+		}
+	}
+	if (!solution.solvable)
+	{
+		return false;
+	}
+	solution.steps = f;
+	if (wantPath)
+	{
+		// walk the ways back from the goal, dropping the keys where they were picked up
+		uint64_t c = goalCell;
+		uint32_t m = goalMask;
+		solution.path.resize(solution.steps + 1);
+		for (int i = solution.steps; i >= 0; i--)
+		{
+			int x = (int)(c % grid.width), y = (int)(c / grid.width);
+			solution.path[i] = std::make_pair(x, y);
+			int way = ways[m][c];
+			if (way == 0)
+				break;
+			if (way & 8)
+				m &= ~(1u << keyBit[grid.entity(x, y)->index]);
+			int d = (way & 7) - 1;
+			c = (uint64_t)(y - solveStepY[d]) * grid.width + (x - solveStepX[d]);
+		}
+	}
+	return true;
+}
+
+// from the start with no keys, what a fresh level needs
+bool solveMaze(const MazeInstance& maze, MazeSolution& solution, SolveMethod method = SOLVE_BFS, bool wantPath = false)
+{
+	return solveMazeFrom(maze, solution, maze.player.startx, maze.player.starty, false, method, wantPath);
+}
@@ -0,0 +1,168 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <unordered_map>
+#include "mapformat.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+// wall bits of a tiled binary map (map2bin -t) that stay on disk.
+// tiles are read in when a cell in them is asked for and kept in a small LRU cache,
+// so resident memory is maxTiles * 8 KB however big the map is.
+// Grid forwards isWall here for such maps, nothing else needs to know about tiles.
+class TileStore {
+public:
+	int width = 0;
+	int height = 0;
+	size_t maxTiles = 64;
+
+	TileStore() {}
+	~TileStore()
+	{
+		close();
+	}
+	// base is where the map starts inside the file, it is not 0 for a level in a pack
+	bool open(const std::string& fileName, size_t maxTiles = 64, uint64_t base = 0)
+	{
+		close();
+#ifdef _WIN32
+		file = fopen(fileName.c_str(), "rb");
+		if (file == NULL)
+			return false;
+#else
+		fd = ::open(fileName.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+#endif
+		MapBinHeader header;
+		if (!readAt(base, &header, sizeof(header)) || memcmp(header.magic, MAPBIN_MAGIC, 4) != 0 || !(header.flags & MAPBIN_TILED))
+		{
+			close();
+			return false;
+		}
+		width = header.width;
+		height = header.height;
+		tilesX = mapBinTilesX(header.width);
+		wallOffset = base + header.wallOffset;
+		this->maxTiles = maxTiles > 0 ? maxTiles : 1;
+		return true;
+	}
+	void close()
+	{
+#ifdef _WIN32
+		if (file != NULL)
+			fclose(file);
+		file = NULL;
+#else
+		if (fd >= 0)
+			::close(fd);
+		fd = -1;
+#endif
+		lru.clear();
+		lookup.clear();
+		lastKey = NO_TILE;
+		lastBits = NULL;
+	}
+	// x, y must be inside the map
+	bool isWall(int x, int y)
+	{
+		const uint64_t* bits = tile(x / TILE_SIZE, y / TILE_SIZE);
+		int tx = x % TILE_SIZE;
+		int ty = y % TILE_SIZE;
+		return (bits[ty * TILE_WORDS_PER_ROW + (tx >> 6)] >> (tx & 63)) & 1;
+	}
+	// pull in the tiles around (x, y) so the next frames do not stall on disk
+	void prefetch(int x, int y, int radius)
+	{
+		int tx0 = (x - radius) / TILE_SIZE, tx1 = (x + radius) / TILE_SIZE;
+		int ty0 = (y - radius) / TILE_SIZE, ty1 = (y + radius) / TILE_SIZE;
+		for (int ty = ty0 < 0 ? 0 : ty0; ty <= ty1 && ty * TILE_SIZE < height; ty++)
+		{
+			for (int tx = tx0 < 0 ? 0 : tx0; tx <= tx1 && tx * TILE_SIZE < width; tx++)
+			{
+				tile(tx, ty);
+			}
+		}
+	}
+	// the 256 rows of 4 words of tile (tx, ty), good until the next tile is read in
+	const uint64_t* tileBits(int tx, int ty)
+	{
+		return tile(tx, ty);
+	}
+	size_t residentTiles() const
+	{
+		return lru.size();
+	}
+private:
+	static const uint64_t NO_TILE = ~(uint64_t)0;
+	struct Tile {
+		uint64_t key;
+		std::vector<uint64_t> bits;
+	};
+	std::list<Tile> lru; // most recently used first
+	std::unordered_map<uint64_t, std::list<Tile>::iterator> lookup;
+	// most lookups land in the same tile as the one before, skip the hash for those
+	uint64_t lastKey = NO_TILE;
+	const uint64_t* lastBits = NULL;
+	uint64_t wallOffset = 0;
+	int tilesX = 0;
+#ifdef _WIN32
+	FILE* file = NULL;
+#else
+	int fd = -1;
+#endif
+
+	const uint64_t* tile(int tx, int ty)
+	{
+		uint64_t key = (uint64_t)ty * tilesX + tx;
+		if (key == lastKey)
+		{
+			return lastBits;
+		}
+		std::unordered_map<uint64_t, std::list<Tile>::iterator>::iterator it = lookup.find(key);
+		if (it != lookup.end())
+		{
+			lru.splice(lru.begin(), lru, it->second);
+		}
+		else
+		{
+			if (lru.size() >= maxTiles) // reuse the least recently used tile's memory
+			{
+				lookup.erase(lru.back().key);
+				lru.splice(lru.begin(), lru, --lru.end());
+			}
+			else
+			{
+				lru.push_front(Tile());
+				lru.front().bits.resize(TILE_WORDS);
+			}
+			Tile& fresh = lru.front();
+			fresh.key = key;
+			if (!readAt(wallOffset + key * TILE_BYTES, fresh.bits.data(), TILE_BYTES))
+			{
+				std::fill(fresh.bits.begin(), fresh.bits.end(), ~(uint64_t)0); // unreadable: all wall
+			}
+			lookup[key] = lru.begin();
+		}
+		lastKey = key;
+		lastBits = lru.front().bits.data();
+		return lastBits;
+	}
+	bool readAt(uint64_t offset, void* dst, size_t bytes)
+	{
+#ifdef _WIN32
+		if (_fseeki64(file, (long long)offset, SEEK_SET) != 0)
+			return false;
+		return fread(dst, 1, bytes, file) == bytes;
+#else
+		return pread(fd, dst, bytes, (off_t)offset) == (ssize_t)bytes;
+#endif
+	}
+	TileStore(const TileStore&);
+	TileStore& operator=(const TileStore&);
+};
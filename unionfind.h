@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+// disjoint sets over 0..n-1 with path halving and union by size, for the generators
+// that join cells into one tree (eller.h, ...)
+class union_find
+{
+public:
+	std::vector<uint32_t> parent;
+	std::vector<uint32_t> size;
+	union_find(size_t n = 0)
+	{
+		reset(n);
+	}
+	void reset(size_t n)
+	{
+		parent.resize(n);
+		size.assign(n, 1);
+		for (size_t i = 0; i < n; i++)
+		{
+			parent[i] = (uint32_t)i;
+		}
+	}
+	uint32_t find(uint32_t a)
+	{
+		while (parent[a] != a)
+		{
+			parent[a] = parent[parent[a]];
+			a = parent[a];
+		}
+		return a;
+	}
+	// false if a and b were already in one set
+	bool unite(uint32_t a, uint32_t b)
+	{
+		a = find(a);
+		b = find(b);
+		if (a == b)
+		{
+			return false;
+		}
+		if (size[a] < size[b])
+		{
+			uint32_t t = a;
+			a = b;
+			b = t;
+		}
+		parent[b] = a;
+		size[a] += size[b];
+		return true;
+	}
+};